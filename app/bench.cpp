@@ -0,0 +1,249 @@
+#include "bench.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include <sched.h>
+
+#include "../inc/ltd/cli.hpp"
+#include "../inc/ltd/fmt.hpp"
+
+#include "jobs.hpp"
+
+namespace fs = std::filesystem;
+
+namespace ltd
+{
+    namespace sdk
+    {
+        namespace
+        {
+            double median(std::vector<double> samples)
+            {
+                if (samples.size() == 0)
+                    return 0;
+
+                std::sort(samples.begin(), samples.end());
+
+                size_t middle = samples.size() / 2;
+                return samples.size() % 2 == 1 ? samples[middle] : (samples[middle - 1] + samples[middle]) / 2;
+            }
+
+            // Median absolute deviation, the spread that ignores outliers
+            double deviation(const std::vector<double>& samples)
+            {
+                double center = median(samples);
+
+                std::vector<double> deviations;
+                for (auto sample : samples)
+                    deviations.push_back(std::fabs(sample - center));
+
+                return median(deviations);
+            }
+
+            string format_millis(double micros)
+            {
+                return fmt::sprintf("%.3f ms", micros / 1000);
+            }
+
+            /**
+             * @brief
+             * Read the samples of the last accepted run from a history file.
+             * Each line is `<time> <ok|slow> <sample>...`, samples in microseconds.
+             */
+            std::vector<double> load_baseline(const string& path)
+            {
+                std::vector<double> baseline;
+
+                std::ifstream file(path);
+                string line;
+
+                while (std::getline(file, line)) {
+                    std::istringstream items(line);
+
+                    long long time;
+                    string status;
+                    if (!(items >> time >> status) || status != "ok")
+                        continue;
+
+                    std::vector<double> samples;
+                    double sample;
+                    while (items >> sample)
+                        samples.push_back(sample);
+
+                    if (samples.size() > 0)
+                        baseline = samples;
+                }
+
+                return baseline;
+            }
+
+            void append_history(const string& path, bool accepted, const std::vector<double>& samples)
+            {
+                std::ofstream file(path, std::ios::app);
+
+                file << (long long)std::time(nullptr) << (accepted ? " ok" : " slow");
+                for (auto sample : samples)
+                    file << ' ' << (long long)sample;
+                file << '\n';
+            }
+
+            /**
+             * @brief
+             * Pin the process to one CPU, the benchmarks inherit the affinity.
+             *
+             * @returns The CPU pinned to, -1 if pinning failed.
+             */
+            int pin_cpu(int cpu, cpu_set_t& previous)
+            {
+                CPU_ZERO(&previous);
+                if (sched_getaffinity(0, sizeof(previous), &previous) != 0)
+                    return -1;
+
+                // The last CPU is the least likely to run the interrupts and the desktop
+                if (cpu < 0) {
+                    for (int i = CPU_SETSIZE - 1; i >= 0 && cpu < 0; i--) {
+                        if (CPU_ISSET(i, &previous))
+                            cpu = i;
+                    }
+                }
+
+                cpu_set_t pinned;
+                CPU_ZERO(&pinned);
+                CPU_SET(cpu, &pinned);
+
+                if (sched_setaffinity(0, sizeof(pinned), &pinned) != 0)
+                    return -1;
+
+                return cpu;
+            }
+        }
+
+        double slowdown_p_value(const std::vector<double>& baseline, const std::vector<double>& samples)
+        {
+            size_t n1 = samples.size();
+            size_t n2 = baseline.size();
+
+            if (n1 == 0 || n2 == 0)
+                return 1;
+
+            std::vector<std::pair<double, bool>> all;
+            for (auto sample : samples)
+                all.push_back({ sample, true });
+            for (auto sample : baseline)
+                all.push_back({ sample, false });
+
+            std::sort(all.begin(), all.end());
+
+            // Rank sum of the new samples, ties share their average rank
+            double rank_sum = 0;
+            for (size_t i = 0; i < all.size(); ) {
+                size_t j = i;
+                while (j < all.size() && all[j].first == all[i].first)
+                    j++;
+
+                double rank = (i + 1 + j) / 2.0;
+                for (size_t k = i; k < j; k++) {
+                    if (all[k].second)
+                        rank_sum += rank;
+                }
+
+                i = j;
+            }
+
+            double u     = rank_sum - n1 * (n1 + 1) / 2.0;
+            double mean  = n1 * n2 / 2.0;
+            double sigma = std::sqrt(n1 * n2 * (n1 + n2 + 1) / 12.0);
+
+            double z = (u - mean - 0.5) / sigma;
+            return 0.5 * std::erfc(z / std::sqrt(2.0));
+        }
+
+        err run_benchmarks(const string_list& binaries, const BenchOptions& options)
+        {
+            std::error_code ec;
+            fs::create_directories(options.history_path, ec);
+
+            cpu_set_t previous;
+            int cpu = pin_cpu(options.cpu, previous);
+
+            if (cpu < 0)
+                cli::warn("Unable to pin the benchmarks to a CPU, timings will be noisy");
+            else
+                cli::info("Benchmarks pinned to CPU %d", cpu);
+
+            int failed = 0;
+            int slower = 0;
+
+            for (const auto& binary : binaries) {
+                string name = fs::path(binary).filename();
+                string history = options.history_path + "/" + name + ".history";
+
+                std::vector<double> samples;
+                Job job;
+                int result = 0;
+
+                for (int trial = -1; trial < options.trials && result == 0; trial++) {
+                    job.output.clear();
+
+                    uint64_t start = steady_micros();
+                    result = run_process(binary, job);
+                    uint64_t end = steady_micros();
+
+                    if (trial >= 0)
+                        samples.push_back((double)(end - start));
+                }
+
+                if (result != 0) {
+                    failed++;
+                    fmt::println("FAIL %-32s exit code %d", name, result);
+
+                    for (const auto& line : split(job.output, "\n"))
+                        fmt::println("     %s", line);
+
+                    continue;
+                }
+
+                double current = median(samples);
+                double spread = current > 0 ? deviation(samples) / current * 100 : 0;
+
+                std::vector<double> baseline = load_baseline(history);
+
+                string comparison = "no baseline";
+                bool slow = false;
+
+                if (baseline.size() > 0) {
+                    double before = median(baseline);
+                    double change = before > 0 ? current / before - 1 : 0;
+                    double p = slowdown_p_value(baseline, samples);
+
+                    slow = change > options.threshold && p < options.alpha;
+                    comparison = fmt::sprintf("%+.1f", change * 100) + "% of " + fmt::sprintf("%s, p=%.3f", format_millis(before), p);
+                }
+
+                if (slow)
+                    slower++;
+
+                string variation = fmt::sprintf("+-%.1f", spread) + "%";
+
+                fmt::println("%s %-32s %12s  %7s  %s", slow ? "SLOW" : "OK  ", name, format_millis(current), variation, comparison);
+
+                append_history(history, !slow || options.accept, samples);
+            }
+
+            if (cpu >= 0)
+                sched_setaffinity(0, sizeof(previous), &previous);
+
+            fmt::println("\n%d benchmarks, %d slower, %d failed, %d trials each", (int)binaries.size(), slower, failed, options.trials);
+
+            if (slower > 0 && options.accept)
+                fmt::println("Slower results accepted as the new baseline.");
+
+            return failed > 0 || (slower > 0 && !options.accept) ? err::invalid_state : err::no_error;
+        }
+    } // namespace sdk
+} // namespace ltd
@@ -0,0 +1,59 @@
+#ifndef _LTD_INCLUDE_BENCH_HPP_
+#define _LTD_INCLUDE_BENCH_HPP_
+
+#include <vector>
+
+#include "../inc/ltd/stddef.hpp"
+#include "../inc/ltd/err.hpp"
+
+namespace ltd
+{
+    namespace sdk
+    {
+        /**
+         * @brief
+         * Options of `ltd bench`.
+         */
+        struct BenchOptions
+        {
+            int    trials = 10;         // Timed runs of every benchmark, after one warm up run.
+            int    cpu = -1;            // CPU the benchmarks are pinned to, the last allowed one when negative.
+            double threshold = 0.05;    // Smallest slowdown of the median that fails, relative.
+            double alpha = 0.05;        // Significance level of the slowdown.
+            bool   accept = false;      // Record the results as the baseline, even when slower.
+
+            string history_path;        // Directory of the result history, one file per benchmark.
+        };
+
+        /**
+         * @brief
+         * Get the probability of samples at least as much slower than the
+         * baseline as `samples` are, if both came from the same distribution.
+         *
+         * @details
+         * One sided Mann-Whitney U test with the normal approximation, which
+         * makes no assumption on the shape of the timing distribution and is
+         * not thrown off by a few outliers.
+         */
+        double slowdown_p_value(const std::vector<double>& baseline, const std::vector<double>& samples);
+
+        /**
+         * @brief
+         * Run benchmark executables one after another on a pinned CPU and
+         * compare their timings with the history.
+         *
+         * @details
+         * Every executable runs once to warm up the caches and then `trials`
+         * times, the wall time of each run is a sample. The samples are compared
+         * with the last accepted run in `<history_path>/<name>.history` and
+         * appended to it, marked `slow` when the median is slower by more than
+         * the threshold and the slowdown is significant, `ok` otherwise. A slow
+         * run does not become the baseline unless it is accepted.
+         *
+         * @returns err::invalid_state if a benchmark failed or got slower.
+         */
+        err run_benchmarks(const string_list& binaries, const BenchOptions& options);
+    } // namespace sdk
+} // namespace ltd
+
+#endif // _LTD_INCLUDE_BENCH_HPP_
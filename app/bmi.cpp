@@ -0,0 +1,297 @@
+#include "bmi.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <set>
+
+#include "../inc/ltd/cli.hpp"
+#include "../inc/ltd/fmt.hpp"
+
+namespace ltd
+{
+    namespace sdk
+    {
+        namespace
+        {
+            string trim(const string& text)
+            {
+                size_t begin = text.find_first_not_of(" \t\r");
+                if (begin == string::npos)
+                    return "";
+
+                size_t end = text.find_last_not_of(" \t\r");
+                return text.substr(begin, end - begin + 1);
+            }
+
+            bool starts_with(const string& text, const string& prefix)
+            {
+                return text.compare(0, prefix.length(), prefix) == 0;
+            }
+
+            // The name after a keyword, up to the ';' or an attribute
+            string declared_name(const string& line, size_t start)
+            {
+                string rest = trim(line.substr(start));
+                size_t end = rest.find_first_of(";[ \t");
+
+                return trim(rest.substr(0, end));
+            }
+        }
+
+        bool supports_modules(const string& standard)
+        {
+            size_t index = standard.find("++");
+            if (index == string::npos)
+                return false;
+
+            string version = standard.substr(index + 2);
+            return version == "20" || version == "2a" || version == "23" || version == "2b" ||
+                   version == "26" || version == "2c";
+        }
+
+        err scan_module_unit(const string& source, ModuleUnit& unit)
+        {
+            std::ifstream file(source);
+            if (!file)
+                return err::not_found;
+
+            bool in_comment = false;
+
+            string line;
+            while (std::getline(file, line)) {
+                line = trim(line);
+
+                if (in_comment) {
+                    size_t end = line.find("*/");
+                    if (end == string::npos)
+                        continue;
+
+                    in_comment = false;
+                    line = trim(line.substr(end + 2));
+                }
+
+                if (starts_with(line, "/*")) {
+                    size_t end = line.find("*/", 2);
+                    if (end == string::npos) {
+                        in_comment = true;
+                        continue;
+                    }
+
+                    line = trim(line.substr(end + 2));
+                }
+
+                if (line.length() == 0 || starts_with(line, "//") || starts_with(line, "#"))
+                    continue;
+
+                // The global module fragment and the private module fragment
+                if (line == "module;" || starts_with(line, "module :private"))
+                    continue;
+
+                bool exported = starts_with(line, "export ");
+                string declaration = exported ? trim(line.substr(7)) : line;
+
+                if (starts_with(declaration, "module ")) {
+                    string name = declared_name(declaration, 7);
+
+                    // An implementation unit depends on its interface, partitions have BMIs of their own
+                    if (exported || name.find(':') != string::npos)
+                        unit.provides = name;
+                    else
+                        unit.imports.push_back(name);
+
+                    continue;
+                }
+
+                if (starts_with(declaration, "import ")) {
+                    string name = declared_name(declaration, 7);
+
+                    if (starts_with(name, "<")) {
+                        size_t end = declaration.find('>');
+                        size_t begin = declaration.find('<');
+                        if (end != string::npos)
+                            unit.header_units.push_back(declaration.substr(begin + 1, end - begin - 1));
+                    } else if (starts_with(name, ":")) {
+                        string module = unit.provides.substr(0, unit.provides.find(':'));
+                        if (module.length() == 0 && unit.imports.size() > 0)
+                            module = unit.imports.at(0);
+
+                        unit.imports.push_back(module + name);
+                    } else if (name.length() > 0 && !starts_with(name, "\"")) {
+                        unit.imports.push_back(name);
+                    }
+
+                    continue;
+                }
+
+                // Module declarations come before any other code
+                break;
+            }
+
+            return err::no_error;
+        }
+
+        ModuleGraph::ModuleGraph(const string& bmi_dir, const string& cache_dir)
+        {
+            this->bmi_dir   = bmi_dir;
+            this->cache_dir = cache_dir;
+        }
+
+        string ModuleGraph::get_bmi_dir() const
+        {
+            return bmi_dir;
+        }
+
+        string ModuleGraph::get_cache_dir() const
+        {
+            return cache_dir;
+        }
+
+        bool ModuleGraph::scan(const string_list& sources)
+        {
+            bool found = false;
+
+            for (const auto& source : sources) {
+                std::lock_guard<std::mutex> lock(mutex);
+
+                if (units.count(source) > 0) {
+                    found = true;
+                    continue;
+                }
+
+                ModuleUnit unit;
+                if (scan_module_unit(source, unit) != err::no_error)
+                    continue;
+
+                if (unit.provides.length() > 0 || unit.imports.size() > 0 || unit.header_units.size() > 0) {
+                    units[source] = unit;
+                    found = true;
+                }
+            }
+
+            return found;
+        }
+
+        const ModuleUnit* ModuleGraph::find_unit(const string& source)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            auto found = units.find(source);
+            return found != units.end() ? &found->second : nullptr;
+        }
+
+        string_list ModuleGraph::order(const string_list& sources)
+        {
+            std::map<string, string> providers;
+            for (const auto& source : sources) {
+                const ModuleUnit* unit = find_unit(source);
+                if (unit != nullptr && unit->provides.length() > 0)
+                    providers[unit->provides] = source;
+            }
+
+            string_list ordered;
+            std::set<string> visited;
+
+            // Cycles are left to the compiler to report
+            std::function<void(const string&)> visit = [&](const string& source) {
+                if (visited.count(source) > 0)
+                    return;
+
+                visited.insert(source);
+
+                const ModuleUnit* unit = find_unit(source);
+                if (unit != nullptr) {
+                    for (const auto& import : unit->imports) {
+                        auto provider = providers.find(import);
+                        if (provider != providers.end())
+                            visit(provider->second);
+                    }
+                }
+
+                ordered.push_back(source);
+            };
+
+            for (const auto& source : sources)
+                visit(source);
+
+            return ordered;
+        }
+
+        string ModuleGraph::module_bmi(const string& name) const
+        {
+            // The module mapper names partitions 'module-partition'
+            string file = name;
+            std::replace(file.begin(), file.end(), ':', '-');
+
+            return bmi_dir + "/" + file + ".gcm";
+        }
+
+        string ModuleGraph::header_bmi(const string& header)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            auto found = headers.find(header);
+            return found != headers.end() ? bmi_dir + found->second + ".gcm" : "";
+        }
+
+        string ModuleGraph::resolve_header(const string& header, const string& compile_command)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+
+                auto found = headers.find(header);
+                if (found != headers.end())
+                    return found->second;
+            }
+
+            // The compiler lists the file it includes for the header first, after the predefined ones
+            Job job;
+            string command = fmt::sprintf("printf '#include <%s>\\n' | %s -M -x c++ -", header, compile_command);
+
+            string path;
+            if (run_process(command, job) == 0) {
+                for (auto token : split(job.output, " ")) {
+                    token = trim(token);
+                    while (token.length() > 0 && (token.back() == '\\' || token.back() == '\n'))
+                        token = trim(token.substr(0, token.length() - 1));
+
+                    if (token.length() > header.length() && token.at(0) == '/' &&
+                        token.compare(token.length() - header.length() - 1, string::npos, "/" + header) == 0) {
+                        path = token;
+                        break;
+                    }
+                }
+            }
+
+            if (path.length() == 0) {
+                cli::error("Header unit <%s> not found: %s", header, job.output);
+                return "";
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            headers[header] = path;
+
+            return path;
+        }
+
+        bool ModuleGraph::has_jobs(const string& name)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return jobs.count(name) > 0;
+        }
+
+        JobIds ModuleGraph::get_jobs(const string& name)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            auto found = jobs.find(name);
+            return found != jobs.end() ? found->second : JobIds();
+        }
+
+        void ModuleGraph::set_jobs(const string& name, const JobIds& ids)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs[name] = ids;
+        }
+    } // namespace sdk
+} // namespace ltd
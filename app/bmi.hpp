@@ -0,0 +1,137 @@
+#ifndef _LTD_INCLUDE_BMI_HPP_
+#define _LTD_INCLUDE_BMI_HPP_
+
+#include <map>
+#include <mutex>
+
+#include "../inc/ltd/stddef.hpp"
+#include "../inc/ltd/err.hpp"
+
+#include "jobs.hpp"
+
+namespace ltd
+{
+    namespace sdk
+    {
+        /**
+         * @brief
+         * The C++20 module declarations of a source file.
+         */
+        struct ModuleUnit
+        {
+            string      provides;       // Module the source exports, i.e. 'net' or 'net:tcp'.
+            string_list imports;        // Named modules it imports, partitions with their module.
+            string_list header_units;   // Headers it imports, i.e. 'vector' of `import <vector>;`.
+        };
+
+        /**
+         * @brief
+         * Check whether a C++ standard, i.e. `c++20` or `gnu++2b`, has modules.
+         */
+        bool supports_modules(const string& standard);
+
+        /**
+         * @brief
+         * Read the module declarations of a source.
+         *
+         * @details
+         * Only the preamble is read: the lines up to the first one that is not
+         * empty, a comment, a preprocessor directive or a module or import
+         * declaration, as declarations can not follow other code.
+         *
+         * @returns err::not_found if the source can not be read.
+         */
+        err scan_module_unit(const string& source, ModuleUnit& unit);
+
+        /**
+         * @brief
+         * The module interfaces and header units of a build and the jobs that
+         * build their BMIs.
+         *
+         * @details
+         * BMIs are written by the compiler's module mapper into `bmi_dir`,
+         * named modules as `<name>.gcm` and header units under the path of
+         * their header. Header units only depend on the toolchain and the flags,
+         * so they are also kept in `cache_dir`, shared by all projects built
+         * with the same compiler and flags.
+         */
+        class ModuleGraph
+        {
+        private:
+            string bmi_dir;
+            string cache_dir;
+
+            std::mutex mutex;
+            std::map<string, ModuleUnit> units;     // Sources using modules.
+            std::map<string, JobIds> jobs;          // Jobs building the BMI of a module or header unit.
+            std::map<string, string> headers;       // File of a header unit.
+
+        public:
+            ModuleGraph(const string& bmi_dir, const string& cache_dir);
+
+            string get_bmi_dir() const;
+            string get_cache_dir() const;
+
+            /**
+             * @brief
+             * Scan sources for module declarations. Sources are scanned once.
+             *
+             * @returns true if any of the sources uses modules.
+             */
+            bool scan(const string_list& sources);
+
+            /**
+             * @brief
+             * Get the module declarations of a scanned source.
+             *
+             * @returns nullptr if the source does not use modules.
+             */
+            const ModuleUnit* find_unit(const string& source);
+
+            /**
+             * @brief
+             * Order sources so that every module interface comes before the
+             * sources importing it. The order is otherwise kept.
+             */
+            string_list order(const string_list& sources);
+
+            /**
+             * @brief
+             * Get the BMI file of a named module.
+             */
+            string module_bmi(const string& name) const;
+
+            /**
+             * @brief
+             * Get the BMI file of a header unit, once the header is resolved.
+             */
+            string header_bmi(const string& header);
+
+            /**
+             * @brief
+             * Find the file of a header unit with the compiler.
+             *
+             * @returns The path of the header, empty if it was not found.
+             */
+            string resolve_header(const string& header, const string& compile_command);
+
+            /**
+             * @brief
+             * Check whether the BMI of a module or header unit, named `<header>`,
+             * is known to the graph.
+             */
+            bool has_jobs(const string& name);
+
+            /**
+             * @brief
+             * Get the jobs building the BMI of a module or header unit in the
+             * current build, none when it is up to date.
+             */
+            JobIds get_jobs(const string& name);
+
+            void set_jobs(const string& name, const JobIds& ids);
+        };
+    } // namespace sdk
+} // namespace ltd
+
+#endif // _LTD_INCLUDE_BMI_HPP_
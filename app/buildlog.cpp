@@ -0,0 +1,382 @@
+#include "buildlog.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace ltd
+{
+    namespace sdk
+    {
+        namespace
+        {
+            const char log_magic[] = "LTDLOG01";
+
+            /**
+             * @brief
+             * Writes the binary log with paths interned into a table, so every
+             * path is stored once no matter how many outputs share it.
+             */
+            class LogWriter
+            {
+            private:
+                string buffer;
+                std::unordered_map<string, uint32_t> ids;
+                string_list paths;
+
+            public:
+                uint32_t intern(const string& path)
+                {
+                    auto found = ids.find(path);
+                    if (found != ids.end())
+                        return found->second;
+
+                    uint32_t id = paths.size();
+                    ids.emplace(path, id);
+                    paths.push_back(path);
+
+                    return id;
+                }
+
+                void put(const void* data, size_t size)
+                {
+                    buffer.append(static_cast<const char*>(data), size);
+                }
+
+                void put_u32(uint32_t value) { put(&value, sizeof(value)); }
+                void put_u64(uint64_t value) { put(&value, sizeof(value)); }
+                void put_i64(int64_t value)  { put(&value, sizeof(value)); }
+
+                string finish()
+                {
+                    string header(log_magic, sizeof(log_magic) - 1);
+
+                    uint32_t count = paths.size();
+                    header.append(reinterpret_cast<const char*>(&count), sizeof(count));
+
+                    for (const auto& path : paths) {
+                        uint32_t length = path.size();
+                        header.append(reinterpret_cast<const char*>(&length), sizeof(length));
+                        header.append(path);
+                    }
+
+                    return header + buffer;
+                }
+            };
+
+            /**
+             * @brief
+             * Reads values from the binary log, failing on truncated input.
+             */
+            class LogReader
+            {
+            private:
+                const char *p;
+                const char *end;
+
+            public:
+                bool ok = true;
+
+                LogReader(const string& data) : p(data.data()), end(data.data() + data.size()) {}
+
+                void get(void* data, size_t size)
+                {
+                    if (!ok || (size_t)(end - p) < size) {
+                        ok = false;
+                        std::memset(data, 0, size);
+                        return;
+                    }
+
+                    std::memcpy(data, p, size);
+                    p += size;
+                }
+
+                uint32_t get_u32() { uint32_t value; get(&value, sizeof(value)); return value; }
+                uint64_t get_u64() { uint64_t value; get(&value, sizeof(value)); return value; }
+                int64_t  get_i64() { int64_t value;  get(&value, sizeof(value)); return value; }
+
+                string get_string()
+                {
+                    uint32_t length = get_u32();
+                    if (!ok || (size_t)(end - p) < length) {
+                        ok = false;
+                        return "";
+                    }
+
+                    string text(p, length);
+                    p += length;
+
+                    return text;
+                }
+            };
+
+            int64_t to_ticks(fs::file_time_type time)
+            {
+                return time.time_since_epoch().count();
+            }
+        }
+
+        BuildLog::BuildLog(const string& path) : path(path)
+        {
+
+        }
+
+        string BuildLog::get_path() const
+        {
+            return path;
+        }
+
+        err BuildLog::load()
+        {
+            FILE *file = std::fopen(path.c_str(), "rb");
+            if (file == nullptr)
+                return err::no_error;
+
+            string data;
+            char buffer[65536];
+            size_t count;
+
+            while ((count = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+                data.append(buffer, count);
+
+            std::fclose(file);
+
+            size_t magic_size = sizeof(log_magic) - 1;
+            if (data.size() < magic_size || data.compare(0, magic_size, log_magic) != 0)
+                return err::no_error;
+
+            data.erase(0, magic_size);
+            LogReader reader(data);
+
+            string_list paths(reader.get_u32());
+            for (auto& p : paths)
+                p = reader.get_string();
+
+            auto path_of = [&](uint32_t id) -> string {
+                if (id >= paths.size()) {
+                    reader.ok = false;
+                    return "";
+                }
+                return paths[id];
+            };
+
+            std::unordered_map<string, LogEntry> read_entries;
+            std::unordered_map<string, DirEntry> read_dirs;
+
+            uint32_t entry_count = reader.get_u32();
+            for (uint32_t i = 0; i < entry_count && reader.ok; i++) {
+                string output = path_of(reader.get_u32());
+
+                LogEntry entry;
+                entry.command_hash = reader.get_u64();
+                entry.mtime        = reader.get_i64();
+
+                uint32_t input_count = reader.get_u32();
+                for (uint32_t j = 0; j < input_count && reader.ok; j++)
+                    entry.inputs.push_back(path_of(reader.get_u32()));
+
+                read_entries[output] = entry;
+            }
+
+            uint32_t dir_count = reader.get_u32();
+            for (uint32_t i = 0; i < dir_count && reader.ok; i++) {
+                string dir = path_of(reader.get_u32());
+
+                DirEntry entry;
+                entry.mtime = reader.get_i64();
+
+                uint32_t file_count = reader.get_u32();
+                for (uint32_t j = 0; j < file_count && reader.ok; j++)
+                    entry.files.push_back(path_of(reader.get_u32()));
+
+                read_dirs[dir] = entry;
+            }
+
+            // A truncated log is ignored as a whole
+            if (!reader.ok)
+                return err::no_error;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            entries.swap(read_entries);
+            dirs.swap(read_dirs);
+
+            return err::no_error;
+        }
+
+        err BuildLog::save()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            if (!modified)
+                return err::no_error;
+
+            LogWriter writer;
+
+            writer.put_u32(entries.size());
+            for (const auto& [output, entry] : entries) {
+                writer.put_u32(writer.intern(output));
+                writer.put_u64(entry.command_hash);
+                writer.put_i64(entry.mtime);
+                writer.put_u32(entry.inputs.size());
+                for (const auto& input : entry.inputs)
+                    writer.put_u32(writer.intern(input));
+            }
+
+            writer.put_u32(dirs.size());
+            for (const auto& [dir, entry] : dirs) {
+                writer.put_u32(writer.intern(dir));
+                writer.put_i64(entry.mtime);
+                writer.put_u32(entry.files.size());
+                for (const auto& file : entry.files)
+                    writer.put_u32(writer.intern(file));
+            }
+
+            string data = writer.finish();
+            string tmp_path = path + ".tmp";
+
+            FILE *file = std::fopen(tmp_path.c_str(), "wb");
+            if (file == nullptr)
+                return err::not_found;
+
+            bool written = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+            std::fclose(file);
+
+            if (!written || std::rename(tmp_path.c_str(), path.c_str()) != 0)
+                return err::invalid_operation;
+
+            modified = false;
+
+            return err::no_error;
+        }
+
+        fs::file_time_type BuildLog::get_time(const string& file)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            auto found = times.find(file);
+            if (found != times.end())
+                return found->second;
+
+            std::error_code ec;
+            auto time = fs::last_write_time(file, ec);
+            if (ec)
+                time = fs::file_time_type::min();
+
+            times.emplace(file, time);
+
+            return time;
+        }
+
+        void BuildLog::invalidate(const string& file)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            times.erase(file);
+        }
+
+        bool BuildLog::is_dirty(const string& output, uint64_t command_hash)
+        {
+            LogEntry entry;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+
+                auto found = entries.find(output);
+                if (found == entries.end())
+                    return true;
+
+                entry = found->second;
+            }
+
+            if (entry.command_hash != command_hash)
+                return true;
+
+            // Removed or touched outside of ltd
+            if (to_ticks(get_time(output)) != entry.mtime)
+                return true;
+
+            for (const auto& input : entry.inputs) {
+                auto time = get_time(input);
+
+                if (time == fs::file_time_type::min() || to_ticks(time) > entry.mtime)
+                    return true;
+            }
+
+            return false;
+        }
+
+        bool BuildLog::is_recorded(const string& output, uint64_t command_hash)
+        {
+            int64_t mtime;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+
+                auto found = entries.find(output);
+                if (found == entries.end() || found->second.command_hash != command_hash)
+                    return false;
+
+                mtime = found->second.mtime;
+            }
+
+            return to_ticks(get_time(output)) == mtime;
+        }
+
+        void BuildLog::record(const string& output, uint64_t command_hash, const string_list& inputs)
+        {
+            invalidate(output);
+
+            LogEntry entry;
+            entry.command_hash = command_hash;
+            entry.mtime        = to_ticks(get_time(output));
+            entry.inputs       = inputs;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            entries[output] = entry;
+            modified = true;
+        }
+
+        bool BuildLog::get_inputs(const string& output, string_list& inputs)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            auto found = entries.find(output);
+            if (found == entries.end())
+                return false;
+
+            inputs = found->second.inputs;
+
+            return true;
+        }
+
+        void BuildLog::list_sources(const string& dir, string_list& sources)
+        {
+            int64_t mtime = to_ticks(get_time(dir));
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+
+                auto found = dirs.find(dir);
+                if (found != dirs.end() && found->second.mtime == mtime) {
+                    sources = found->second.files;
+                    return;
+                }
+            }
+
+            DirEntry entry;
+            entry.mtime = mtime;
+
+            std::error_code ec;
+            for(const auto& dir_entry : fs::directory_iterator(dir, ec)) {
+                auto ext = dir_entry.path().extension();
+
+                if (ext == ".cpp" || ext == ".cc" || ext == ".cxx" || ext == ".cppm" || ext == ".ixx")
+                    entry.files.push_back(dir_entry.path());
+            }
+
+            std::sort(entry.files.begin(), entry.files.end());
+            sources = entry.files;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            dirs[dir] = entry;
+            modified = true;
+        }
+    } // namespace sdk
+} // namespace ltd
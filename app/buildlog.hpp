@@ -0,0 +1,138 @@
+#ifndef _LTD_INCLUDE_BUILDLOG_HPP_
+#define _LTD_INCLUDE_BUILDLOG_HPP_
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <unordered_map>
+
+#include "../inc/ltd/stddef.hpp"
+#include "../inc/ltd/err.hpp"
+
+namespace fs = std::filesystem;
+
+namespace ltd
+{
+    namespace sdk
+    {
+        /**
+         * @brief
+         * What the build log remembers about one output file.
+         */
+        struct LogEntry
+        {
+            uint64_t    command_hash = 0;   // Hash of the command that produced the output.
+            int64_t     mtime = 0;          // Modification time of the output after it was built.
+            string_list inputs;             // Sources, headers, objects or libraries it was built from.
+        };
+
+        /**
+         * @brief
+         * What the build log remembers about a source directory.
+         */
+        struct DirEntry
+        {
+            int64_t     mtime = 0;          // Modification time of the directory when it was listed.
+            string_list files;              // Source files found in the directory.
+        };
+
+        /**
+         * @brief
+         * Persistent binary log of a build directory, similar to ninja's
+         * `.ninja_log` and `.ninja_deps`.
+         *
+         * @details
+         * For each output the log records the hash of the command line, its
+         * modification time and its inputs, including the headers found in the
+         * depfile. An output is dirty when it is not in the log, when its command
+         * changed, when it was modified or removed outside of ltd, or when any of
+         * its inputs is newer. Modification times are cached, so every file is
+         * stat'ed at most once per build, and source directory listings are
+         * reused as long as the directory itself is unchanged.
+         *
+         * All methods are safe to call from concurrent jobs.
+         */
+        class BuildLog
+        {
+        private:
+            string path;
+
+            std::mutex mutex;
+            std::unordered_map<string, LogEntry> entries;
+            std::unordered_map<string, DirEntry> dirs;
+            std::unordered_map<string, fs::file_time_type> times;
+
+            bool modified = false;
+
+        public:
+            BuildLog(const string& path);
+
+            string get_path() const;
+
+            /**
+             * @brief
+             * Read the log from disk. A missing or incompatible log is not an
+             * error, it simply makes every output dirty.
+             */
+            err load();
+
+            /**
+             * @brief
+             * Write the log to disk if anything was recorded.
+             */
+            err save();
+
+            /**
+             * @brief
+             * Get the modification time of a file, cached for the lifetime of
+             * the log.
+             *
+             * @returns fs::file_time_type::min() if the file does not exist.
+             */
+            fs::file_time_type get_time(const string& file);
+
+            /**
+             * @brief
+             * Forget the cached modification time of a file.
+             */
+            void invalidate(const string& file);
+
+            /**
+             * @brief
+             * Check whether an output needs to be rebuilt with the given command.
+             */
+            bool is_dirty(const string& output, uint64_t command_hash);
+
+            /**
+             * @brief
+             * Check whether an output exists as it was recorded with the given
+             * command, regardless of its inputs. Used to decide whether an
+             * output can be updated in place.
+             */
+            bool is_recorded(const string& output, uint64_t command_hash);
+
+            /**
+             * @brief
+             * Record a successfully built output.
+             */
+            void record(const string& output, uint64_t command_hash, const string_list& inputs);
+
+            /**
+             * @brief
+             * Get the inputs recorded for an output.
+             *
+             * @returns false if the output is not in the log.
+             */
+            bool get_inputs(const string& output, string_list& inputs);
+
+            /**
+             * @brief
+             * List the C++ sources of a directory, reusing the recorded list when
+             * the directory has not been modified since.
+             */
+            void list_sources(const string& dir, string_list& sources);
+        };
+    } // namespace sdk
+} // namespace ltd
+
+#endif // _LTD_INCLUDE_BUILDLOG_HPP_
@@ -0,0 +1,231 @@
+#include "cache.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "jobs.hpp"
+#include "hash.hpp"
+
+namespace fs = std::filesystem;
+
+namespace ltd
+{
+    namespace sdk
+    {
+        ObjectCache::ObjectCache(const string& cache_dir) : cache_dir(cache_dir), hits(0), misses(0)
+        {
+
+        }
+
+        string ObjectCache::get_cache_dir() const
+        {
+            return cache_dir;
+        }
+
+        string ObjectCache::get_compiler_id(const string& compiler)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            auto found = compiler_ids.find(compiler);
+            if (found != compiler_ids.end())
+                return found->second;
+
+            Job job;
+            run_process(compiler + " --version", job);
+
+            compiler_ids[compiler] = compiler + "\n" + job.output;
+
+            return compiler_ids[compiler];
+        }
+
+        namespace
+        {
+            struct Entry
+            {
+                string_list files;
+                uintmax_t size = 0;
+                fs::file_time_type time = fs::file_time_type::min();     // Last use.
+            };
+
+            // Entries are spread over directories named after the first two hex digits of their key
+            bool is_entry_dir(const fs::path& path)
+            {
+                string name = path.filename();
+                return name.length() == 2 && name.find_first_not_of("0123456789abcdef") == string::npos;
+            }
+
+            /**
+             * @brief
+             * Collect the entries of the cache by key, the files of an entry
+             * are named after the key.
+             */
+            std::map<string,Entry> list_entries(const string& cache_dir)
+            {
+                std::map<string,Entry> entries;
+
+                std::error_code ec;
+                for (const auto& dir_entry : fs::directory_iterator(cache_dir, ec)) {
+                    if (!is_entry_dir(dir_entry.path()))
+                        continue;
+
+                    for (const auto& file : fs::directory_iterator(dir_entry.path(), ec)) {
+                        string file_name = file.path().filename();
+                        Entry& entry = entries[file_name.substr(0, file_name.find('.'))];
+
+                        std::error_code file_ec;
+                        uintmax_t size = file.file_size(file_ec);
+                        auto time = file.last_write_time(file_ec);
+
+                        entry.files.push_back(file.path());
+                        entry.size += file_ec ? 0 : size;
+                        entry.time  = file_ec ? entry.time : std::max(entry.time, time);
+                    }
+                }
+
+                return entries;
+            }
+        }
+
+        bool ObjectCache::fetch(const string& key, const string& obj, string& output, bool with_dwo)
+        {
+            string cached = entry_path(key, ".o");
+
+            std::error_code ec;
+            if (with_dwo) {
+                string dwo = fs::path(obj).replace_extension(".dwo");
+                fs::copy_file(entry_path(key, ".dwo"), dwo, fs::copy_options::overwrite_existing, ec);
+            }
+
+            if (!ec)
+                fs::copy_file(cached, obj, fs::copy_options::overwrite_existing, ec);
+
+            if (ec) {
+                misses++;
+                return false;
+            }
+
+            fs::last_write_time(cached, fs::file_time_type::clock::now(), ec);
+
+            std::ifstream file(entry_path(key, ".out"));
+            if (file) {
+                std::stringstream buffer;
+                buffer << file.rdbuf();
+                output += buffer.str();
+            }
+
+            hits++;
+            return true;
+        }
+
+        void ObjectCache::store(const string& key, const string& obj, const string& output, bool with_dwo)
+        {
+            std::error_code ec;
+            fs::create_directories(fs::path(entry_path(key, ".o")).parent_path(), ec);
+
+            // Write to a temporary file first so concurrent builds never see a
+            // partially written entry.
+            std::ostringstream suffix;
+            suffix << ".tmp." << getpid() << "." << std::this_thread::get_id();
+
+            if (output.length() > 0) {
+                string tmp_out = entry_path(key, ".out") + suffix.str();
+                std::ofstream file(tmp_out);
+                file << output;
+                file.close();
+                fs::rename(tmp_out, entry_path(key, ".out"), ec);
+            }
+
+            // The object is stored last, an entry with an object is complete
+            if (with_dwo) {
+                string tmp_dwo = entry_path(key, ".dwo") + suffix.str();
+                fs::copy_file(fs::path(obj).replace_extension(".dwo"), tmp_dwo, fs::copy_options::overwrite_existing, ec);
+                if (ec)
+                    return;
+
+                fs::rename(tmp_dwo, entry_path(key, ".dwo"), ec);
+            }
+
+            string tmp_obj = entry_path(key, ".o") + suffix.str();
+            fs::copy_file(obj, tmp_obj, fs::copy_options::overwrite_existing, ec);
+            if (!ec)
+                fs::rename(tmp_obj, entry_path(key, ".o"), ec);
+        }
+
+        int ObjectCache::get_hits() const
+        {
+            return hits;
+        }
+
+        int ObjectCache::get_misses() const
+        {
+            return misses;
+        }
+
+        void ObjectCache::get_usage(int& entries, uintmax_t& size) const
+        {
+            auto all = list_entries(cache_dir);
+
+            entries = all.size();
+            size = 0;
+            for (const auto& [key, entry] : all)
+                size += entry.size;
+        }
+
+        int ObjectCache::trim(uintmax_t max_size)
+        {
+            auto all = list_entries(cache_dir);
+
+            uintmax_t size = 0;
+            std::vector<std::pair<fs::file_time_type, const Entry*>> by_use;
+            for (const auto& [key, entry] : all) {
+                size += entry.size;
+                by_use.push_back({ entry.time, &entry });
+            }
+
+            if (size <= max_size)
+                return 0;
+
+            std::sort(by_use.begin(), by_use.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+            int removed = 0;
+            for (const auto& [time, entry] : by_use) {
+                if (size <= max_size)
+                    break;
+
+                std::error_code ec;
+                for (const auto& file : entry->files)
+                    fs::remove(file, ec);
+
+                size -= entry->size;
+                removed++;
+            }
+
+            return removed;
+        }
+
+        int ObjectCache::clear()
+        {
+            int removed = list_entries(cache_dir).size();
+
+            std::error_code ec;
+            for (const auto& dir_entry : fs::directory_iterator(cache_dir, ec)) {
+                std::error_code remove_ec;
+                if (is_entry_dir(dir_entry.path()))
+                    fs::remove_all(dir_entry.path(), remove_ec);
+            }
+
+            return removed;
+        }
+
+        string ObjectCache::entry_path(const string& key, const string& ext) const
+        {
+            return cache_dir + "/" + key.substr(0, 2) + "/" + key + ext;
+        }
+    } // namespace sdk
+} // namespace ltd
@@ -0,0 +1,106 @@
+#ifndef _LTD_INCLUDE_CACHE_HPP_
+#define _LTD_INCLUDE_CACHE_HPP_
+
+#include <atomic>
+#include <map>
+#include <mutex>
+
+#include "../inc/ltd/stddef.hpp"
+#include "../inc/ltd/err.hpp"
+
+namespace ltd
+{
+    namespace sdk
+    {
+        /**
+         * @brief
+         * Size limit of the object cache in MB used when `LTD_CACHE_SIZE` is
+         * not set.
+         */
+        const long DEFAULT_CACHE_SIZE = 5 * 1024;
+
+        /**
+         * @brief
+         * Content addressed object file cache.
+         *
+         * @details
+         * Objects are stored under `<cache_dir>/<2 hex>/<32 hex>.o`, keyed by the
+         * hash of the preprocessed source, the compiler identity and the
+         * compile flags. The compiler output of the original compilation is kept
+         * next to the object and replayed on a hit, so warnings are not lost.
+         *
+         * A hit touches the object, so the modification time of an entry is
+         * the time it was last used, the order it is trimmed in.
+         */
+        class ObjectCache
+        {
+        private:
+            string cache_dir;
+
+            std::mutex mutex;
+            std::map<string,string> compiler_ids;
+
+            std::atomic<int> hits;
+            std::atomic<int> misses;
+
+        public:
+            ObjectCache(const string& cache_dir);
+
+            string get_cache_dir() const;
+
+            /**
+             * @brief
+             * Get a string identifying the compiler binary and version. The
+             * compiler is only queried once per ltd run.
+             */
+            string get_compiler_id(const string& compiler);
+
+            /**
+             * @brief
+             * Restore the object for the key into `obj`, with the split DWARF
+             * file next to it when `with_dwo` is set.
+             *
+             * @returns true on a cache hit.
+             */
+            bool fetch(const string& key, const string& obj, string& output, bool with_dwo = false);
+
+            /**
+             * @brief
+             * Store a freshly compiled object and its compiler output, with the 
+             * split DWARF file next to it when `with_dwo` is set.
+             */
+            void store(const string& key, const string& obj, const string& output, bool with_dwo = false);
+
+            int get_hits() const;
+            int get_misses() const;
+
+            /**
+             * @brief
+             * Get the number of entries and their size in bytes.
+             */
+            void get_usage(int& entries, uintmax_t& size) const;
+
+            /**
+             * @brief
+             * Remove the least recently used entries until the cache holds at
+             * most `max_size` bytes.
+             *
+             * @returns The number of entries removed.
+             */
+            int trim(uintmax_t max_size);
+
+            /**
+             * @brief
+             * Remove every entry.
+             *
+             * @returns The number of entries removed.
+             */
+            int clear();
+
+        private:
+            string entry_path(const string& key, const string& ext) const;
+        };
+    } // namespace sdk
+} // namespace ltd
+
+#endif // _LTD_INCLUDE_CACHE_HPP_
@@ -1,26 +1,39 @@
 #include "compiler.hpp"
 
+#include <algorithm>
+#include <cstdlib>
 #include <filesystem>
+#include <fstream>
+#include <set>
+#include <sstream>
+
+#include <unistd.h>
 
 namespace fs = std::filesystem;
 
 #include "../inc/ltd/fmt.hpp"
 #include "../inc/ltd/cli.hpp"
 
+#include "depfile.hpp"
+#include "hash.hpp"
+#include "toolchain.hpp"
+
 namespace ltd
 {
     namespace sdk
     {
-        Cpp::Cpp()
+        string get_default_compiler()
         {
-
+            const char* compiler = getenv("CXX");
+            return compiler != nullptr && *compiler != '\0' ? compiler : "g++";
         }
 
-        Cpp::Cpp(const Cpp& other)
+        Cpp::Cpp()
         {
-            compiler = other.compiler;
-            standard = other.standard;
-            debug    = other.debug;
+            compiler = get_default_compiler();
+
+            // Without a persistent log every output is considered dirty
+            log = std::make_shared<BuildLog>("");
         }
 
         void Cpp::add_inc_path(const string& path)
@@ -38,6 +51,16 @@ namespace ltd
             libraries.push_back(lib_name);
         }
 
+        void Cpp::add_flag(const string& flag)
+        {
+            extra_flags.push_back(flag);
+        }
+
+        void Cpp::add_link_flag(const string& flag)
+        {
+            extra_link_flags.push_back(flag);
+        }
+
         string Cpp::get_compiler() const
         {
             return compiler;
@@ -60,105 +83,714 @@ namespace ltd
 
         bool Cpp::is_debug() const
         {
-            return debug;
+            return profile.debug;
+        }
+
+        const BuildProfile& Cpp::get_profile() const
+        {
+            return profile;
+        }
+
+        void Cpp::set_profile(const BuildProfile& build_profile)
+        {
+            profile = build_profile;
+        }
+
+        bool Cpp::is_lto() const
+        {
+            return lto;
+        }
+
+        void Cpp::set_lto(bool link_time_optimization)
+        {
+            lto = link_time_optimization;
+        }
+
+        string Cpp::get_linker() const
+        {
+            return linker;
+        }
+
+        void Cpp::set_linker(const string& linker_name)
+        {
+            linker = linker_name;
+        }
+
+        bool Cpp::is_time_trace() const
+        {
+            return time_trace;
+        }
+
+        void Cpp::set_time_trace(bool trace)
+        {
+            time_trace = trace && compiler.find("clang") != string::npos;
+        }
+
+        PgoMode Cpp::get_pgo() const
+        {
+            return pgo;
+        }
+
+        void Cpp::set_pgo(PgoMode mode, const string& data_dir, const string& build_dir)
+        {
+            pgo        = mode;
+            pgo_data   = data_dir;
+            pgo_prefix = build_dir;
+        }
+
+        bool Cpp::is_thin_archives() const
+        {
+            return thin_archives;
+        }
+
+        void Cpp::set_thin_archives(bool thin)
+        {
+            thin_archives = thin;
+        }
+
+        int Cpp::get_unity_size() const
+        {
+            return unity_size;
+        }
+
+        void Cpp::set_unity_size(int size)
+        {
+            unity_size = size;
+        }
+
+        std::shared_ptr<ObjectCache> Cpp::get_cache() const
+        {
+            return cache;
+        }
+
+        void Cpp::set_cache(std::shared_ptr<ObjectCache> object_cache)
+        {
+            cache = object_cache;
+        }
+
+        std::shared_ptr<CompileWorkers> Cpp::get_workers() const
+        {
+            return workers;
+        }
+
+        void Cpp::set_workers(std::shared_ptr<CompileWorkers> compile_workers)
+        {
+            workers = compile_workers;
+        }
+
+        std::shared_ptr<BuildLog> Cpp::get_log() const
+        {
+            return log;
+        }
+
+        void Cpp::set_log(std::shared_ptr<BuildLog> build_log)
+        {
+            log = build_log;
+        }
+
+        std::shared_ptr<ModuleGraph> Cpp::get_modules() const
+        {
+            return modules;
+        }
+
+        void Cpp::set_modules(std::shared_ptr<ModuleGraph> module_graph)
+        {
+            modules = module_graph;
+        }
+
+        string Cpp::get_pch_key() const
+        {
+            Hash key;
+            key.update(compiler);
+            key.update(compile_flags());
+
+            return key.hex().substr(0, 16);
+        }
+
+        void Cpp::set_pch(const string& stub, const JobIds& jobs)
+        {
+            pch = stub;
+            pch_jobs = jobs;
+        }
+
+        JobIds Cpp::build_pch(const string& header, const string& stub, Jobs& queue) const
+        {
+            string gch = stub + ".gch";
+            string content = fmt::sprintf("#include \"%s\"\n", fs::absolute(header).string());
+
+            // The stub is only rewritten when it changes, its time is an input
+            std::ifstream in(stub);
+            std::stringstream current;
+            current << in.rdbuf();
+
+            if (!in || current.str() != content) {
+                fs::create_directories(fs::path(stub).parent_path());
+
+                std::ofstream out(stub, std::ios::trunc);
+                out << content;
+                out.close();
+
+                log->invalidate(stub);
+            }
+
+            string command = pch_command(stub, gch);
+
+            if (!log->is_dirty(gch, hash_string(command)))
+                return {};
+
+            Job job;
+            job.name          = fs::path(header).filename();
+            job.category      = "pch";
+            job.message       = fmt::sprintf("Precompiling header: %s", fs::path(header).filename());
+            job.message_level = cli::LOG_INFO;
+            job.command       = command;
+            job.target        = gch;
+            job.action        = [this, command, stub, gch](Job& self) {
+                int result = run_process(command, self);
+
+                if (result == 0) {
+                    string_list deps;
+                    if (parse_depfile(stub + ".d", deps) != err::no_error)
+                        deps.push_back(stub);
+
+                    log->record(gch, hash_string(command), deps);
+                }
+
+                return result;
+            };
+
+            queue.push_back(job);
+
+            return { queue.size() - 1 };
+        }
+
+        JobIds Cpp::build_header_unit(const string& header, Jobs& queue) const
+        {
+            string resolved = modules->resolve_header(header, compiler + " -std=" + standard);
+            if (resolved.length() == 0)
+                return {};
+
+            string bmi = modules->header_bmi(header);
+            string command = fmt::sprintf("%s %s -x c++-system-header %s", compiler, compile_flags(), header);
+
+            if (!log->is_dirty(bmi, hash_string(command)))
+                return {};
+
+            // Include paths and the mapper do not change a system header, the code flags do
+            Hash key;
+            key.update(code_flags());
+
+            string cached = modules->get_cache_dir() + "/" + key.hex().substr(0, 16) + resolved + ".gcm";
+
+            Job job;
+            job.name          = header;
+            job.category      = "bmi";
+            job.message       = fmt::sprintf("Building header unit: <%s>", header);
+            job.message_level = cli::LOG_INFO;
+            job.command       = command;
+            job.target        = bmi;
+            job.action        = [this, command, resolved, bmi, cached](Job& self) {
+                std::error_code ec;
+                fs::create_directories(fs::path(bmi).parent_path(), ec);
+
+                int result = 0;
+                bool fresh = fs::exists(cached, ec) && fs::last_write_time(cached, ec) >= fs::last_write_time(resolved, ec);
+
+                if (!fresh || !fs::copy_file(cached, bmi, fs::copy_options::overwrite_existing, ec)) {
+                    result = run_process(command, self);
+
+                    // Written aside and renamed, concurrent builds may store the same unit
+                    if (result == 0) {
+                        string staged = fmt::sprintf("%s.%d", cached, getpid());
+
+                        fs::create_directories(fs::path(cached).parent_path(), ec);
+                        if (fs::copy_file(bmi, staged, fs::copy_options::overwrite_existing, ec))
+                            fs::rename(staged, cached, ec);
+                    }
+                } else {
+                    cli::debug("Header unit from cache: %s", cached);
+                }
+
+                if (result == 0)
+                    log->record(bmi, hash_string(command), { resolved });
+
+                return result;
+            };
+
+            queue.push_back(job);
+
+            return { queue.size() - 1 };
         }
 
-        void Cpp::set_debug(bool debug_mode)
+        string Cpp::code_flags() const
         {
-            debug = debug_mode;
+            string profile_flags = profile.compile_flags();
+            if (profile_flags.length() > 0)
+                profile_flags = " " + profile_flags;
+
+            if (lto)
+                profile_flags += " -flto=auto -ffunction-sections -fdata-sections";
+
+            for (const auto& flag : extra_flags)
+                profile_flags += " " + flag;
+
+            if (pgo == PGO_GENERATE) {
+                profile_flags += fmt::sprintf(" -fprofile-generate=%s -fprofile-prefix-path=%s -fprofile-update=prefer-atomic", 
+                                              pgo_data, pgo_prefix);
+            } else if (pgo == PGO_USE) {
+                // Untrained and edited sources keep building, until the next training
+                profile_flags += fmt::sprintf(" -fprofile-use=%s -fprofile-prefix-path=%s -fprofile-partial-training -Wno-missing-profile -Wno-error=coverage-mismatch", 
+                                              pgo_data, pgo_prefix);
+            }
+
+            return fmt::sprintf("-std=%s%s", standard, profile_flags);
         }
 
-        void Cpp::compile_file(const string& src, const string& dst) const
+        string Cpp::compile_flags() const
         {
             string inc_flags;
             for (auto inc_path : inc_paths) {
                 inc_flags += " -I" + inc_path;
             }
 
-            auto command = fmt::sprintf("%s -std=%s -c %s -o %s %s", compiler, standard, src, dst, inc_flags);
-            cli::trace(command);
-            auto result = std::system(command.c_str());
+            // The mapper server reads and writes the BMIs in its root dir
+            if (modules)
+                inc_flags += fmt::sprintf(" -fmodules-ts '-fmodule-mapper=|@g++-mapper-server -r%s'", modules->get_bmi_dir());
+
+            return code_flags() + inc_flags;
         }
 
-        int Cpp::compile_files(const string& src_dir, const string& obj_dir) const
+        namespace
         {
-            Entries entries;
-            int counter = 0;
+            // Module interfaces often have extensions the compiler driver does not know
+            string language_flag(const string& src)
+            {
+                string ext = fs::path(src).extension();
+                return ext == ".cppm" || ext == ".ixx" ? "-x c++ " : "";
+            }
 
-            // Collecting dirty source files for compilation
-            for(const auto& dir_entry : fs::directory_iterator(src_dir)) 
+            // A definition of main starts its line, i.e. 'int main(' or 'auto main('
+            bool defines_main(const string& src)
             {
-                auto ext = dir_entry.path().extension();
+                std::ifstream file(src);
+                string line;
+
+                while (std::getline(file, line)) {
+                    size_t index = line.find_first_not_of(" \t");
+                    if (index == string::npos)
+                        continue;
+
+                    for (auto prefix : { "int main(", "int main (", "auto main(", "auto main (" }) {
+                        if (line.compare(index, std::char_traits<char>::length(prefix), prefix) == 0)
+                            return true;
+                    }
+                }
 
-                if (ext == ".cpp" || ext == ".cc" || ext == ".cxx") {
-                    string src_file = dir_entry.path().c_str();
+                return false;
+            }
+        }
+
+        string Cpp::compile_command(const string& src, const string& dst) const
+        {
+            string depfile = fs::path(dst).replace_extension(".d");
+            string prefix = pch.length() > 0 ? " -include " + pch : "";
 
-                    string obj_file = dir_entry.path().filename().replace_extension(".o");
-                    
-                    obj_file = obj_dir + "/" + obj_file.c_str();
+            // The compiler only strips the prefix from the profile data names of relative objects
+            if (pgo != PGO_OFF) {
+                string relative_dst = fs::path(dst).lexically_relative(pgo_prefix);
 
-                    bool need_compile = true;
-                    if(std::filesystem::exists(obj_file)) {
-                        auto srctime = std::filesystem::last_write_time(src_file);
-                        auto objtime = std::filesystem::last_write_time(obj_file);
+                return fmt::sprintf("cd %s && %s %s%s -MMD -MF %s -c %s%s -o %s", 
+                                    pgo_prefix, compiler, compile_flags(), prefix, depfile, language_flag(src), src, relative_dst);
+            }
+
+            return fmt::sprintf("%s %s%s -MMD -MF %s -c %s%s -o %s", 
+                                compiler, compile_flags(), prefix, depfile, language_flag(src), src, dst);
+        }
 
-                        need_compile = srctime > objtime;
+        string Cpp::pch_command(const string& header, const string& dst) const
+        {
+            string depfile = header + ".d";
+
+            return fmt::sprintf("%s %s -MMD -MF %s -x c++-header -c %s -o %s", 
+                                compiler, compile_flags(), depfile, header, dst);
+        }
+
+        string Cpp::link_flags() const
+        {
+            string flags;
+
+            if (linker.length() > 0)
+                flags += " -fuse-ld=" + linker;
+
+            // The index lets the debugger find symbols without reading every .dwo
+            if (profile.is_split_dwarf() && supports_link_flags(compiler, flags + " -Wl,--gdb-index"))
+                flags += " -Wl,--gdb-index";
+
+            // Links the profiling runtime
+            if (pgo == PGO_GENERATE)
+                flags += " -fprofile-generate=" + pgo_data;
+
+            if (lto) {
+                // The optimization level is repeated for the link time code generation
+                flags += " -flto=auto";
+                if (profile.optimize.length() > 0)
+                    flags += " " + profile.optimize;
+
+                flags += " -Wl,--gc-sections";
+
+                if (supports_link_flags(compiler, flags + " -Wl,--icf=all"))
+                    flags += " -Wl,--icf=all";
+            }
+
+            return flags.length() > 0 ? flags.substr(1) : "";
+        }
+
+        string Cpp::preprocess_command(const string& src, const string& dst) const
+        {
+            string depfile = fs::path(dst).replace_extension(".d");
+            string prefix = pch.length() > 0 ? " -include " + pch : "";
+
+            // The prefix header is expanded as text, the .gch is not read by -E
+            return fmt::sprintf("%s %s%s -MMD -MF %s -E %s%s -o %s", 
+                                compiler, compile_flags(), prefix, depfile, language_flag(src), src, dst);
+        }
+
+        int Cpp::compile_file(const string& src, const string& dst, Job& job) const
+        {
+            // Does not change the object, so it is not part of the logged command
+            string command = compile_command(src, dst);
+            if (time_trace)
+                command += " -ftime-trace";
+
+            // The object refers to its .dwo by path
+            bool split_dwarf = profile.is_split_dwarf();
+
+            // Only an object that does not depend on local files can be compiled remotely
+            bool remote = workers && pgo == PGO_OFF && !time_trace && !split_dwarf;
+
+            // Module units read and write BMIs, which neither the cache nor a worker has
+            if (modules && modules->find_unit(src) != nullptr)
+                return run_process(command, job);
+
+            if (!cache && !remote)
+                return run_process(command, job);
+
+            // Preprocessing also writes the depfile, which stays valid on a hit
+            string preprocessed = fs::path(dst).replace_extension(".ii");
+
+            int result = run_process(preprocess_command(src, preprocessed), job);
+            if (result != 0)
+                return result;
+
+            Hash key;
+            err e = err::invalid_state;
+
+            if (cache) {
+                key.update(cache->get_compiler_id(compiler));
+                key.update(compile_flags());
+
+                if (split_dwarf)
+                    key.update(dst);
+
+                e = key.update_file(preprocessed);
+
+                if (e == err::no_error && cache->fetch(key.hex(), dst, job.output, split_dwarf)) {
+                    fs::remove(preprocessed);
+                    return 0;
+                }
+            }
+
+            string output;
+            std::swap(output, job.output);
+
+            // Include paths mean nothing to a preprocessed source, the code flags suffice
+            if (remote && workers->compile(code_flags(), preprocessed, dst, job))
+                result = 0;
+            else
+                result = run_process(command, job);
+
+            fs::remove(preprocessed);
+
+            if (cache && result == 0 && e == err::no_error)
+                cache->store(key.hex(), dst, job.output, split_dwarf);
+
+            job.output = output + job.output;
+
+            return result;
+        }
+
+        JobIds Cpp::compile_files(const string& src_dir, const string& obj_dir, string_list& objects, Jobs& queue) const
+        {
+            string_list sources;
+
+            log->list_sources(src_dir, sources);
+
+            // Interfaces are compiled before their importers, a unity batch would hide them
+            if (modules)
+                sources = modules->order(sources);
+            else if (unity_size > 1 && sources.size() > 1)
+                sources = unity_sources(sources, obj_dir);
+
+            JobIds ids;
+            for(const auto& src : sources) 
+            {
+                fs::path file = src;
+                string dst = obj_dir + "/" + file.filename().replace_extension(".o").c_str();
+
+                objects.push_back(dst);
+
+                const ModuleUnit* unit = modules ? modules->find_unit(src) : nullptr;
+
+                // A rebuilt BMI is not written yet, its jobs make the importers dirty
+                JobIds deps = pch_jobs;
+                string_list bmis;
+
+                if (unit != nullptr) {
+                    for (const auto& header : unit->header_units) {
+                        string name = "<" + header + ">";
+                        if (!modules->has_jobs(name))
+                            modules->set_jobs(name, build_header_unit(header, queue));
+
+                        JobIds built = modules->get_jobs(name);
+                        deps.insert(deps.end(), built.begin(), built.end());
+                        bmis.push_back(modules->header_bmi(header));
                     }
-                    
-                    if(need_compile) {
-                        Entry entry = std::make_pair(src_file, obj_file);
-                        entries.push_back(entry);
+
+                    for (const auto& import : unit->imports) {
+                        JobIds built = modules->get_jobs(import);
+                        deps.insert(deps.end(), built.begin(), built.end());
+                        bmis.push_back(modules->module_bmi(import));
                     }
                 }
+
+                // The command, the source and every header it includes are checked
+                bool dirty = deps.size() > 0 || log->is_dirty(dst, hash_string(compile_command(src, dst)));
+
+                if (unit != nullptr && unit->provides.length() > 0 && !fs::exists(modules->module_bmi(unit->provides)))
+                    dirty = true;
+
+                if (!dirty)
+                    continue;
+
+                Job job;
+                job.name     = file.filename();
+                job.command  = compile_command(src, dst);
+                job.target   = dst;
+                job.category = "compile";
+                job.deps     = deps;
+                job.action   = [this, src, dst, bmis](Job& self) { 
+                    int result = compile_file(src, dst, self);
+
+                    if (result == 0) {
+                        string_list deps;
+                        if (parse_depfile(fs::path(dst).replace_extension(".d"), deps) != err::no_error)
+                            deps.push_back(src);
+
+                        // Headers inside the .gch are not listed by the compiler
+                        if (pch.length() > 0)
+                            deps.push_back(pch + ".gch");
+
+                        if (pgo == PGO_USE)
+                            deps.push_back(pgo_data + "/.trained");
+
+                        // Neither are the imported BMIs, of the modules built here
+                        for (const auto& bmi : bmis) {
+                            if (bmi.length() > 0 && fs::exists(bmi))
+                                deps.push_back(bmi);
+                        }
+
+                        log->record(dst, hash_string(self.command), deps);
+                    }
+
+                    return result;
+                };
+
+                if (unit != nullptr && unit->provides.length() > 0)
+                    modules->set_jobs(unit->provides, { queue.size() });
+
+                ids.push_back(queue.size());
+                queue.push_back(job);
             }
 
-            if(entries.size() == 0)
+            if(ids.size() == 0)
                 cli::info("No files found for compilation...");
- 
-            for(int i=0; i<entries.size(); i++) {
-                fs::path file = entries[i].first;
-                cli::debug("Compiling %d of %d... %s", i+1, entries.size(), file.filename());
-                compile_file(entries[i].first, entries[i].second);
 
-                counter++;
+            for(size_t i=0; i<ids.size(); i++)
+                queue[ids[i]].message = fmt::sprintf("Compiling %d of %d... %s", i+1, ids.size(), queue[ids[i]].name);
+
+            return ids;
+        }
+
+        string_list Cpp::unity_sources(const string_list& sources, const string& obj_dir) const
+        {
+            string_list unity_files;
+            string_list batched;
+
+            // Tests link with the objects of an application, which must not bring its main along
+            for (const auto& src : sources) {
+                if (defines_main(src))
+                    unity_files.push_back(src);
+                else
+                    batched.push_back(src);
+            }
+
+            for (size_t first = 0, batch = 0; first < batched.size(); first += unity_size, batch++) {
+                string unity_file = fmt::sprintf("%s/unity_%d.cpp", obj_dir, batch);
+
+                string content;
+                for (size_t i = first; i < batched.size() && i < first + unity_size; i++)
+                    content += fmt::sprintf("#include \"%s\"\n", fs::absolute(batched[i]).string());
+
+                std::ifstream in(unity_file);
+                std::stringstream current;
+                current << in.rdbuf();
+
+                if (!in || current.str() != content) {
+                    std::ofstream out(unity_file, std::ios::trunc);
+                    out << content;
+                    out.close();
+
+                    log->invalidate(unity_file);
+                }
+
+                unity_files.push_back(unity_file);
             }
 
-            return counter;
+            return unity_files;
         }
 
-        void Cpp::build_lib(const string& obj_dir, const string& lib_target) const
+        string_list Cpp::library_files() const
         {
-            string obj_files;
-            
-            for(const auto& dir_entry : fs::directory_iterator(obj_dir)) {
-                auto ext = dir_entry.path().extension();
-                if (ext == ".o") {
-                    string obj_file = dir_entry.path().c_str();
-                    obj_files += obj_file;
-                    obj_files += " ";
+            string_list files;
+
+            for (const auto& library : libraries) {
+                for (const auto& lib_path : lib_paths) {
+                    string file = lib_path + "/lib" + library + ".a";
+
+                    if (log->get_time(file) != fs::file_time_type::min()) {
+                        files.push_back(file);
+                        break;
+                    }
                 }
             }
 
+            return files;
+        }
+
+        Job Cpp::link_job(const string& name, const string& command, uint64_t command_hash, 
+                          const string& output, const string_list& objects) const
+        {
+            Job job;
+
+            job.name          = name;
+            job.category      = "link";
+            job.message_level = cli::LOG_INFO;
+            job.command       = command;
+            job.target        = output;
+            job.action        = [this, command, command_hash, output, objects](Job& self) {
+                int result = run_process(command, self);
+
+                if (result == 0) {
+                    string_list inputs = objects;
+                    for (const auto& file : library_files())
+                        inputs.push_back(file);
+
+                    log->record(output, command_hash, inputs);
+                }
+
+                return result;
+            };
+
+            return job;
+        }
+
+        JobIds Cpp::build_lib(const string_list& objects, const string& lib_target, const JobIds& after, Jobs& queue) const
+        {
+            // The log keys archives by their format, the members are its inputs
+            string archiver = get_archiver(compiler, lto);
+            string ar_flags = thin_archives ? "rcs --thin" : "rcs";
+            uint64_t archive_hash = hash_string(fmt::sprintf("%s %s %s", archiver, ar_flags, lib_target));
+
+            string_list members;
+            bool recorded = log->get_inputs(lib_target, members) && log->is_recorded(lib_target, archive_hash);
+
             fs::path target_path = lib_target;
-            cli::info("Creating lib: %s", target_path.filename());
 
-            auto link_command = "ar rcs " + lib_target + " " + obj_files;
+            if (after.size() == 0 && members == objects && !log->is_dirty(lib_target, archive_hash)) {
+                cli::info("Binary is up-to-date: %s", target_path.filename());
+                return {};
+            }
+
+            // GNU ar can not delete members of a thin archive, recreating it is cheap
+            if (recorded && thin_archives) {
+                for (const auto& member : members) {
+                    if (std::find(objects.begin(), objects.end(), member) == objects.end())
+                        recorded = false;
+                }
+            }
+
+            string link_command;
 
-            cli::trace(link_command.c_str());
-            auto result = std::system(link_command.c_str());
+            if (recorded) {
+                // Replace the members compiled now or since the last archive step
+                std::set<string> compiled;
+                for (auto id : after)
+                    compiled.insert(queue[id].target);
+
+                auto lib_time = log->get_time(lib_target);
+
+                string changed;
+                for (const auto& obj_file : objects) {
+                    bool added = std::find(members.begin(), members.end(), obj_file) == members.end();
+
+                    if (added || compiled.count(obj_file) > 0 || log->get_time(obj_file) > lib_time)
+                        changed += " " + obj_file;
+                }
+
+                string removed;
+                for (const auto& member : members) {
+                    if (std::find(objects.begin(), objects.end(), member) == objects.end())
+                        removed += " " + fs::path(member).filename().string();
+                }
+
+                if (removed.length() > 0)
+                    link_command = fmt::sprintf("%s d %s%s", archiver, lib_target, removed);
+
+                if (changed.length() > 0) {
+                    if (link_command.length() > 0)
+                        link_command += " && ";
+
+                    link_command += fmt::sprintf("%s %s %s%s", archiver, ar_flags, lib_target, changed);
+                }
+
+                // Only the member order changed, the archive is still complete
+                if (link_command.length() == 0)
+                    link_command = fmt::sprintf("touch %s", lib_target);
+            } else {
+                string obj_files;
+                for (const auto& obj_file : objects)
+                    obj_files += " " + obj_file;
+
+                // Start from an empty archive, so a normal and a thin one are never mixed
+                link_command = fmt::sprintf("rm -f %s && %s %s %s%s", lib_target, archiver, ar_flags, lib_target, obj_files);
+            }
+
+            Job job = link_job(target_path.filename(), link_command, archive_hash, lib_target, objects);
+            job.message  = fmt::sprintf("Creating lib: %s", target_path.filename());
+            job.category = "archive";
+            job.deps     = after;
+
+            queue.push_back(job);
+
+            return { queue.size() - 1 };
         }
 
-        void Cpp::build_app(const string& obj_dir, const string& target) const
+        JobIds Cpp::build_app(const string_list& objects, const string& target, const JobIds& after, Jobs& queue) const
         {
             string obj_files;
-            
-            for(const auto& dir_entry : fs::directory_iterator(obj_dir)) {
-                auto ext = dir_entry.path().extension();
-                if (ext == ".o") {
-                    string obj_file = dir_entry.path().c_str();
-                    obj_files += obj_file;
-                    obj_files += " ";
-                }
+            for (const auto& obj_file : objects) {
+                obj_files += obj_file;
+                obj_files += " ";
             }
 
             string lib_paths_flags;
@@ -173,17 +805,33 @@ namespace ltd
                 lib_flags += "-l" + library + " ";
             }
 
+            for (const auto& flag : extra_link_flags)
+                lib_flags += flag + " ";
+
+            string flags = link_flags();
+            if (flags.length() > 0)
+                flags += " ";
+
+            auto link_command = fmt::sprintf("%s %s-o %s %s %s %s", 
+                                compiler, flags, target, obj_files, lib_paths_flags, lib_flags);
+
             fs::path target_path = target;
-            cli::info("Linking app: %s", target_path.filename());
 
-            auto link_command = fmt::sprintf("%s -o %s %s %s %s", 
-                                compiler, target, obj_files, lib_paths_flags, lib_flags);
+            if (after.size() == 0 && !log->is_dirty(target, hash_string(link_command))) {
+                cli::info("Binary is up-to-date: %s", target_path.filename());
+                return {};
+            }
+
+            Job job = link_job(target_path.filename(), link_command, hash_string(link_command), target, objects);
+            job.message = fmt::sprintf("Linking app: %s", target_path.filename());
+            job.deps    = after;
 
-            cli::trace(link_command.c_str());
-            auto result = std::system(link_command.c_str());
+            queue.push_back(job);
+
+            return { queue.size() - 1 };
         }
 
-        void Cpp::build_tests(const string& obj_dir, const string& target) const
+        JobIds Cpp::build_tests(const string_list& objects, const string& target, const JobIds& after, Jobs& queue) const
         {
             string lib_paths_flags;
             for(auto lib_path : lib_paths) 
@@ -193,33 +841,52 @@ namespace ltd
             for(auto library : libraries) 
                 lib_flags += "-l" + library + " ";
 
-            for(const auto& dir_entry : fs::directory_iterator(obj_dir)) {
-                auto ext = dir_entry.path().extension();
-                if (ext == ".o") {
-                    string obj_file = dir_entry.path().c_str();
-                    string test_exec = dir_entry.path().filename().replace_extension("");
+            for (const auto& flag : extra_link_flags)
+                lib_flags += flag + " ";
 
-                    bool need_linking = true;
-                    if(std::filesystem::exists(target+test_exec)) {
-                        auto srctime = std::filesystem::last_write_time(obj_file);
-                        auto objtime = std::filesystem::last_write_time(target+test_exec);
+            string flags = link_flags();
+            if (flags.length() > 0)
+                flags += " ";
 
-                        need_linking = srctime > objtime;
-                    }
+            // A rebuilt library relinks every test, a recompiled object only its own
+            std::set<string> compiled;
+            bool libs_changed = false;
 
-                    if(need_linking) {
-                        cli::info("Linking test unit: '%s'", test_exec);
+            for (auto id : after) {
+                if (std::find(objects.begin(), objects.end(), queue[id].target) != objects.end())
+                    compiled.insert(queue[id].target);
+                else
+                    libs_changed = true;
+            }
+
+            JobIds ids;
+
+            for(const auto& obj_file : objects) {
+                string test_exec = fs::path(obj_file).filename().replace_extension("");
+
+                auto link_command = fmt::sprintf("%s %s-o %s%s %s %s %s", 
+                    compiler, flags, target, test_exec, obj_file, lib_paths_flags, lib_flags);
 
-                        auto link_command = fmt::sprintf("%s -o %s%s %s %s %s", 
-                            compiler, target, test_exec, obj_file, lib_paths_flags, lib_flags);
+                bool need_linking = libs_changed || compiled.count(obj_file) > 0 ||
+                                    log->is_dirty(target + test_exec, hash_string(link_command));
 
-                        cli::trace(link_command.c_str());
-                        auto result = std::system(link_command.c_str());
-                    } else {
-                        cli::info("Unit test is up-to-date: '%s'", test_exec);
+                if(need_linking) {
+                    Job job = link_job(test_exec, link_command, hash_string(link_command), target + test_exec, { obj_file });
+                    job.message = fmt::sprintf("Linking test unit: '%s'", test_exec);
+
+                    for (auto id : after) {
+                        if (queue[id].target == obj_file || compiled.count(queue[id].target) == 0)
+                            job.deps.push_back(id);
                     }
+
+                    ids.push_back(queue.size());
+                    queue.push_back(job);
+                } else {
+                    cli::info("Unit test is up-to-date: '%s'", test_exec);
                 }
             }
+
+            return ids;
         }
     } // namespace sdk
 } // namespace ltd
\ No newline at end of file
@@ -1,31 +1,78 @@
 #ifndef _LTD_INCLUDE_COMPILER_HPP_
 #define _LTD_INCLUDE_COMPILER_HPP_
 
+#include <memory>
+
 #include "../inc/ltd/stddef.hpp"
+#include "../inc/ltd/err.hpp"
+
+#include "jobs.hpp"
+#include "cache.hpp"
+#include "buildlog.hpp"
+#include "profile.hpp"
+#include "worker.hpp"
+#include "bmi.hpp"
 
 namespace ltd
 {
     namespace sdk
     {
+        /**
+         * @brief
+         * Get the compiler used unless a project selects its own: the `CXX`
+         * environment variable, `g++` when it is not set.
+         */
+        string get_default_compiler();
+
+        /**
+         * @brief
+         * Creates the compile, archive and link jobs of a target.
+         *
+         * @details
+         * The jobs refer to the Cpp instance that created them, so it has to
+         * outlive the job pool run.
+         */
         class Cpp
         {
         private:
-            string compiler = "g++";
+            string compiler;
             string standard = "c++17";
-            bool debug = false;
+            BuildProfile profile;
+            int  unity_size = 0;
+            bool thin_archives = false;
+            bool lto = false;
+            string linker;      // Passed with -fuse-ld, the default linker when empty.
+            bool time_trace = false;
+
+            PgoMode pgo = PGO_OFF;
+            string  pgo_data;   // Directory of the .gcda profile data.
+            string  pgo_prefix; // Build dir stripped from the profile data names.
 
             string_list inc_paths;
             string_list lib_paths;
             string_list libraries;
+            string_list extra_flags;        // Compile flags of imported modules.
+            string_list extra_link_flags;   // Link flags of imported modules, after the libraries.
+
+            std::shared_ptr<ObjectCache> cache;
+            std::shared_ptr<CompileWorkers> workers;
+            std::shared_ptr<BuildLog> log;
+            std::shared_ptr<ModuleGraph> modules;
+
+            string pch;         // Prefix header stub, its .gch is next to it.
+            JobIds pch_jobs;    // Jobs rebuilding the .gch in the current queue.
 
         public:
             Cpp();
-            Cpp(const Cpp& other);
 
             void add_inc_path(const string& path);
             void add_lib_path(const string& path);
             void add_library(const string& lib_name);
 
+            void add_flag(const string& flag);
+
+            void add_link_flag(const string& flag);
+
             string get_compiler() const;
             void set_compiler(const string& compiler_command);
 
@@ -33,42 +80,273 @@ namespace ltd
             void set_standard(const string& cpp_standard);
 
             bool is_debug() const;
-            void set_debug(bool debug_mode);
+
+            const BuildProfile& get_profile() const;
+            void set_profile(const BuildProfile& build_profile);
+
+            bool is_lto() const;
+
+            /**
+             * @brief
+             * Optimize at link time: compile with `-flto=auto` and one section
+             * per function and data item, link with `--gc-sections` and with 
+             * `--icf=all` when the linker supports it.
+             */
+            void set_lto(bool link_time_optimization);
+
+            string get_linker() const;
+
+            /**
+             * @brief
+             * Set the linker used by the compiler driver, i.e. `mold` or `lld`.
+             * An empty name uses the default linker.
+             */
+            void set_linker(const string& linker_name);
+
+            bool is_time_trace() const;
+
+            /**
+             * @brief
+             * Let clang write a `-ftime-trace` report next to every object it 
+             * compiles. Other compilers have no such report and ignore it.
+             */
+            void set_time_trace(bool trace);
+
+            PgoMode get_pgo() const;
+
+            /**
+             * @brief
+             * Set the profile guided optimization phase. 
+             *
+             * @details
+             * The profile data of an object is named after its path relative 
+             * to `build_dir`, so the instrumented and the optimized build can 
+             * live in different build directories. The objects are compiled
+             * from `build_dir` for that. In the use phase every 
+             * object depends on `<data_dir>/.trained`, which is touched after
+             * each training run.
+             */
+            void set_pgo(PgoMode mode, const string& data_dir, const string& build_dir);
+
+            bool is_thin_archives() const;
+
+            /**
+             * @brief
+             * Create thin archives, which refer to the object files instead of
+             * holding copies of them.
+             */
+            void set_thin_archives(bool thin);
+
+            int get_unity_size() const;
+
+            /**
+             * @brief
+             * Compile the sources in batches of `size` files, each batch as one 
+             * generated unity source. A size below 2 compiles every source on 
+             * its own, and so is a source defining `main`.
+             */
+            void set_unity_size(int size);
+
+            std::shared_ptr<ObjectCache> get_cache() const;
+            void set_cache(std::shared_ptr<ObjectCache> object_cache);
+
+            std::shared_ptr<CompileWorkers> get_workers() const;
+
+            /**
+             * @brief
+             * Compile on remote workers where possible, the object cache is
+             * still checked first.
+             */
+            void set_workers(std::shared_ptr<CompileWorkers> compile_workers);
+
+            std::shared_ptr<BuildLog> get_log() const;
+            void set_log(std::shared_ptr<BuildLog> build_log);
+
+            std::shared_ptr<ModuleGraph> get_modules() const;
+
+            /**
+             * @brief
+             * Compile C++20 modules: the compiler reads and writes BMIs through
+             * its module mapper in the BMI dir of the graph, sources are compiled
+             * after the interfaces they import and unity batching is off.
+             */
+            void set_modules(std::shared_ptr<ModuleGraph> module_graph);
+
+            /**
+             * @brief
+             * Get a key identifying the compiler and the flags a precompiled
+             * header is only valid for.
+             */
+            string get_pch_key() const;
+
+            /**
+             * @brief
+             * Use a precompiled prefix header for every compilation.
+             *
+             * @param stub The header included with `-include`, its .gch is 
+             *             expected next to it.
+             * @param jobs The jobs rebuilding the .gch, all sources are compiled
+             *             after them when non empty.
+             */
+            void set_pch(const string& stub, const JobIds& jobs);
+
+            /**
+             * @brief
+             * Add a job precompiling a prefix header when it is out of date.
+             *
+             * @details
+             * A stub including `header` is written to `stub` and compiled into
+             * `<stub>.gch` with the current compiler and flags, so one header
+             * can be precompiled for several flag sets side by side.
+             *
+             * @returns The jobs added to the queue.
+             */
+            JobIds build_pch(const string& header, const string& stub, Jobs& queue) const;
+
+            /**
+             * @brief
+             * Add a job building the BMI of a header unit, `import <header>;`,
+             * when it is out of date.
+             *
+             * @details
+             * A BMI found in the cache dir of the module graph is copied instead
+             * of compiled, a compiled one is stored there for other builds with
+             * the same toolchain and flags.
+             *
+             * @returns The jobs added to the queue.
+             */
+            JobIds build_header_unit(const string& header, Jobs& queue) const;
 
             using Entry   = std::pair<string,string>;
             using Entries = std::vector<Entry>;
 
             /**
              * @brief
-             * Compile all files under a directory into .o files.
+             * Add jobs compiling the sources under a directory into .o files. 
+             * Only objects the build log considers dirty are compiled, or all of
+             * them when the precompiled header is rebuilt. With modules a source
+             * is also compiled when a BMI it imports is rebuilt.
+             * 
+             * @param objects Receives all object files of the directory.
+             * @returns The jobs added to the queue.
+             */
+            JobIds compile_files(const string& src_dir, const string& obj_dir, string_list& objects, Jobs& queue) const;
+
+            /**
+             * @brief
+             * Get the flags shared by every compile command, i.e. the standard,
+             * the profile flags and include paths.
+             */
+            string compile_flags() const;
+
+            /**
+             * @brief
+             * Get the command line to compile a singular C++ source file.
+             */
+            string compile_command(const string& src, const string& dst) const;
+
+            /**
+             * @brief
+             * Get the command line to precompile a header.
+             */
+            string pch_command(const string& header, const string& dst) const;
+
+            /**
+             * @brief
+             * Get the command line to preprocess a singular C++ source file.
+             */
+            string preprocess_command(const string& src, const string& dst) const;
+
+            /**
+             * @brief
+             * Get the flags shared by every link command.
+             */
+            string link_flags() const;
+
+            /**
+             * @brief
+             * Compile a singular C++ source file, capturing the compiler output 
+             * into the job. When an object cache is set the source is preprocessed
+             * first and the object is restored from the cache if possible. With
+             * compile workers the preprocessed source is compiled remotely when
+             * a worker is free.
              * 
-             * @returns Number of files compiled.
+             * @returns The exit code of the compiler.
              */
-            int compile_files(const string& src_dir, const string& obj_dir) const;
+            int compile_file(const string& src, const string& dst, Job& job) const;
 
             /**
              * @brief
-             * Compile a singular C++ source file
+             * Add a job creating the .a library file from the object files when it
+             * is out of date.
+             *
+             * @details
+             * An archive recorded in the build log is updated in place: only the
+             * changed and new objects are replaced and the members of removed 
+             * sources deleted. It is created from scratch when it is missing,
+             * was modified outside of ltd or its format changed, and a thin 
+             * archive also when members were removed.
+             * 
+             * @param after Jobs producing inputs of the library, the library is
+             *              rebuilt when any of them is queued.
+             * @returns The jobs added to the queue.
+             */
+            JobIds build_lib(const string_list& objects, const string& lib_target, const JobIds& after, Jobs& queue) const;
+
+            /**
+             * @brief
+             * Add a job linking .o files into an executable when it is out of date.
+             * 
+             * @param after Jobs producing the objects or libraries linked.
+             * @returns The jobs added to the queue.
+             */
+            JobIds build_app(const string_list& objects, const string& target, const JobIds& after, Jobs& queue) const;
+
+            /**
+             * @brief
+             * Add jobs linking each .o file into its own test executable under the
+             * target dir, for the tests that are out of date.
+             * 
+             * @param after Jobs producing the objects or libraries linked.
+             * @returns The jobs added to the queue.
+             */
+            JobIds build_tests(const string_list& objects, const string& target, const JobIds& after, Jobs& queue) const;
+
+        private:
+            /**
+             * @brief
+             * Get the compile flags that change the generated code, the flags
+             * without include paths and module mapper.
              */
-            void compile_file(const string& src, const string& dst) const;
+            string code_flags() const;
 
             /**
              * @brief
-             * Create .a library file using .o files under the specified object directory.
+             * Write the unity sources of a target into the object dir, each 
+             * including a batch of the sorted sources. A file is only rewritten 
+             * when its batch changed, so editing a source recompiles only its
+             * own batch.
+             *
+             * @returns The unity sources.
              */
-            void build_lib(const string& obj_dir, const string& lib_target) const;
+            string_list unity_sources(const string_list& sources, const string& obj_dir) const;
 
             /**
              * @brief
-             * Link .o files into an executable
+             * Resolve the libraries against the library paths, so the archives 
+             * can be tracked as link inputs.
              */
-            void build_app(const string& obj_dir, const string& target) const;
+            string_list library_files() const;
 
             /**
              * @brief
-             * Link .o files into test executables
+             * Create a link job that runs a command and records the output in the 
+             * build log with the command hash when it succeeds. The libraries are
+             * resolved when the job runs, after the libraries it depends on were 
+             * built.
              */
-            void build_tests(const string& obj_dir, const string& target) const;
+            Job link_job(const string& name, const string& command, uint64_t command_hash, 
+                         const string& output, const string_list& objects) const;
         };
     } // namespace sdk
 } // namespace ltd
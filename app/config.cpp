@@ -0,0 +1,93 @@
+#include "config.hpp"
+
+#include <fstream>
+#include <stdexcept>
+
+namespace ltd
+{
+    namespace sdk
+    {
+        namespace
+        {
+            string trim(const string& text)
+            {
+                size_t begin = text.find_first_not_of(" \t\r");
+                if (begin == string::npos)
+                    return "";
+
+                size_t end = text.find_last_not_of(" \t\r");
+                return text.substr(begin, end - begin + 1);
+            }
+        }
+
+        err ProjectConfig::load(const string& path)
+        {
+            std::ifstream file(path);
+            if (!file)
+                return err::not_found;
+
+            string line;
+            while (std::getline(file, line)) {
+                line = trim(line);
+
+                if (line.length() == 0 || line.at(0) == '#')
+                    continue;
+
+                size_t index = line.find('=');
+                if (index == string::npos)
+                    continue;
+
+                values[trim(line.substr(0, index))] = trim(line.substr(index + 1));
+            }
+
+            return err::no_error;
+        }
+
+        bool ProjectConfig::has(const string& key) const
+        {
+            return values.find(key) != values.end();
+        }
+
+        string ProjectConfig::get(const string& key, const string& default_value) const
+        {
+            auto found = values.find(key);
+            return found != values.end() ? found->second : default_value;
+        }
+
+        string_list ProjectConfig::get_list(const string& key) const
+        {
+            string_list list;
+
+            auto found = values.find(key);
+            if (found == values.end() || found->second.length() == 0)
+                return list;
+
+            for (auto item : split(found->second, ":")) {
+                item = trim(item);
+                if (item.length() > 0)
+                    list.push_back(item);
+            }
+
+            return list;
+        }
+
+        int ProjectConfig::get_int(const string& key, int default_value) const
+        {
+            auto found = values.find(key);
+            if (found == values.end())
+                return default_value;
+
+            try {
+                return std::stoi(found->second);
+            } catch (std::exception const& ex)
+            {
+                return default_value;
+            }
+        }
+
+        void ProjectConfig::set(const string& key, const string& value)
+        {
+            values[key] = value;
+        }
+    } // namespace sdk
+} // namespace ltd
@@ -0,0 +1,55 @@
+#ifndef _LTD_INCLUDE_CONFIG_HPP_
+#define _LTD_INCLUDE_CONFIG_HPP_
+
+#include <map>
+
+#include "../inc/ltd/stddef.hpp"
+#include "../inc/ltd/err.hpp"
+
+namespace ltd
+{
+    namespace sdk
+    {
+        /**
+         * @brief
+         * Project configuration read from `ltd.conf` in the project root.
+         *
+         * @details
+         * The file consists of `key = value` lines. Lines starting with '#' are
+         * comments. List values are separated by colon ':', the same way as the
+         * list params on the command line. I.e.:
+         *
+         * ```
+         * # myapp1 only links with mylib1 (and what mylib1 depends on)
+         * myapp1.deps = mylib1
+         * mylib1.deps = mylib2
+         * ```
+         */
+        class ProjectConfig
+        {
+        private:
+            std::map<string,string> values;
+
+        public:
+            /**
+             * @brief
+             * Read the configuration file.
+             *
+             * @returns err::not_found if the file does not exist.
+             */
+            err load(const string& path);
+
+            bool has(const string& key) const;
+
+            string get(const string& key, const string& default_value = "") const;
+
+            string_list get_list(const string& key) const;
+
+            int get_int(const string& key, int default_value) const;
+
+            void set(const string& key, const string& value);
+        };
+    } // namespace sdk
+} // namespace ltd
+
+#endif // _LTD_INCLUDE_CONFIG_HPP_
@@ -0,0 +1,107 @@
+#include "depfile.hpp"
+
+#include <cstdio>
+
+namespace ltd
+{
+    namespace sdk
+    {
+        err parse_depfile(const string& path, string_list& deps)
+        {
+            FILE *file = std::fopen(path.c_str(), "rb");
+            if (file == nullptr)
+                return err::not_found;
+
+            string content;
+            char buffer[16384];
+            size_t count;
+
+            while ((count = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+                content.append(buffer, count);
+
+            std::fclose(file);
+
+            parse_depfile_content(content.data(), content.data() + content.size(), deps);
+
+            return err::no_error;
+        }
+
+        void parse_depfile_content(const char* begin, const char* end, string_list& deps)
+        {
+            const char *p = begin;
+            bool in_target = true;
+            bool skip_rule = false;
+            string token;
+
+            // Modules are named `<name>.c++m`, their BMIs are not inputs of the object
+            auto is_module = [&]() {
+                return token == ".PHONY" || (token.length() > 5 && token.compare(token.length() - 5, 5, ".c++m") == 0);
+            };
+
+            auto flush = [&]() {
+                if (token.length() == 0)
+                    return;
+
+                if (in_target && is_module())
+                    skip_rule = true;
+                else if (!in_target && !skip_rule && !is_module())
+                    deps.push_back(token);
+
+                token.clear();
+            };
+
+            while (p < end) {
+                char c = *p;
+
+                if (c == '\\' && p + 1 < end) {
+                    char next = *(p + 1);
+
+                    if (next == '\n') {
+                        // Line continuation
+                        flush();
+                        p += 2;
+                        continue;
+                    } else if (next == '\r' && p + 2 < end && *(p + 2) == '\n') {
+                        flush();
+                        p += 3;
+                        continue;
+                    } else if (next == ' ' || next == '#' || next == '\\') {
+                        // Escaped character in a path
+                        token += next;
+                        p += 2;
+                        continue;
+                    }
+
+                    token += c;
+                    p++;
+                } else if (c == '$' && p + 1 < end && *(p + 1) == '$') {
+                    token += '$';
+                    p += 2;
+                } else if (c == ':' && in_target && (p + 1 == end || *(p + 1) == ' ' ||
+                                                      *(p + 1) == '\n' || *(p + 1) == '\t')) {
+                    // End of the targets of a rule
+                    if (is_module())
+                        skip_rule = true;
+
+                    token.clear();
+                    in_target = false;
+                    p++;
+                } else if (c == '\n') {
+                    // A new line without continuation starts a new rule
+                    flush();
+                    in_target = true;
+                    skip_rule = false;
+                    p++;
+                } else if (c == ' ' || c == '\t' || c == '\r') {
+                    flush();
+                    p++;
+                } else {
+                    token += c;
+                    p++;
+                }
+            }
+
+            flush();
+        }
+    } // namespace sdk
+} // namespace ltd
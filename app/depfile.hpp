@@ -0,0 +1,30 @@
+#ifndef _LTD_INCLUDE_DEPFILE_HPP_
+#define _LTD_INCLUDE_DEPFILE_HPP_
+
+#include "../inc/ltd/stddef.hpp"
+#include "../inc/ltd/err.hpp"
+
+namespace ltd
+{
+    namespace sdk
+    {
+        /**
+         * @brief
+         * Parse a make style dependency file as written by the compiler with
+         * `-MMD -MF`. The prerequisites of all rules are appended to `deps`,
+         * the targets are skipped. So are the module rules the compiler adds
+         * with `-fmodules-ts`, the imported BMIs are tracked by the caller.
+         *
+         * @returns err::not_found if the file cannot be read.
+         */
+        err parse_depfile(const string& path, string_list& deps);
+
+        /**
+         * @brief
+         * Parse the content of a make style dependency file.
+         */
+        void parse_depfile_content(const char* begin, const char* end, string_list& deps);
+    } // namespace sdk
+} // namespace ltd
+
+#endif // _LTD_INCLUDE_DEPFILE_HPP_
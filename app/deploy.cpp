@@ -0,0 +1,242 @@
+#include "deploy.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <filesystem>
+#include <set>
+
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../inc/ltd/cli.hpp"
+
+namespace fs = std::filesystem;
+
+namespace ltd
+{
+    namespace sdk
+    {
+        namespace
+        {
+            enum CopyMethod
+            {
+                COPY_FAILED,
+                COPY_CLONED,
+                COPY_COPIED
+            };
+
+            CopyMethod copy_file(const string& src, const string& dst, const struct stat& src_stat)
+            {
+                int in = open(src.c_str(), O_RDONLY | O_CLOEXEC);
+                if (in < 0)
+                    return COPY_FAILED;
+
+                int out = open(dst.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, src_stat.st_mode & 07777);
+                if (out < 0) {
+                    close(in);
+                    return COPY_FAILED;
+                }
+
+                CopyMethod method = COPY_FAILED;
+
+                if (ioctl(out, FICLONE, in) == 0) {
+                    method = COPY_CLONED;
+                } else {
+                    off_t remaining = src_stat.st_size;
+                    bool in_kernel = true;
+
+                    while (remaining > 0) {
+                        ssize_t count = -1;
+
+                        if (in_kernel) {
+                            count = copy_file_range(in, nullptr, out, nullptr, remaining, 0);
+
+                            // Not supported across these filesystems, fall back to a buffer
+                            if (count < 0 && (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP)) {
+                                in_kernel = false;
+                                continue;
+                            }
+                        } else {
+                            char buffer[65536];
+                            count = read(in, buffer, sizeof(buffer));
+
+                            for (ssize_t written = 0; count > 0 && written < count; ) {
+                                ssize_t result = write(out, buffer + written, count - written);
+                                if (result < 0) {
+                                    count = -1;
+                                    break;
+                                }
+                                written += result;
+                            }
+                        }
+
+                        if (count < 0 && errno == EINTR)
+                            continue;
+
+                        // The file shrunk while copying
+                        if (count <= 0)
+                            break;
+
+                        remaining -= count;
+                    }
+
+                    method = remaining == 0 ? COPY_COPIED : COPY_FAILED;
+                }
+
+                // Keep the mode, regardless of umask, and the modification time,
+                // the next deploy compares both
+                struct timespec times[2] = { src_stat.st_atim, src_stat.st_mtim };
+                if (method != COPY_FAILED && (fchmod(out, src_stat.st_mode & 07777) != 0 || futimens(out, times) != 0))
+                    method = COPY_FAILED;
+
+                close(in);
+                if (close(out) != 0)
+                    method = COPY_FAILED;
+
+                return method;
+            }
+
+            bool is_unchanged(const struct stat& src_stat, const string& live)
+            {
+                struct stat live_stat;
+                if (stat(live.c_str(), &live_stat) != 0 || !S_ISREG(live_stat.st_mode))
+                    return false;
+
+                return live_stat.st_size == src_stat.st_size &&
+                       live_stat.st_mtim.tv_sec == src_stat.st_mtim.tv_sec &&
+                       live_stat.st_mtim.tv_nsec == src_stat.st_mtim.tv_nsec &&
+                       (live_stat.st_mode & 07777) == (src_stat.st_mode & 07777);
+            }
+
+            err stage_tree(const string& src_dir, const string& live_dir, const string& staged_dir,
+                           const string_list& excluded, std::set<string>& staged, DeployStats& stats)
+            {
+                std::error_code ec;
+                fs::create_directories(staged_dir, ec);
+                if (ec) {
+                    cli::error("Unable to create directory: %s", staged_dir);
+                    return err::invalid_operation;
+                }
+
+                for (const auto& dir_entry : fs::directory_iterator(src_dir, ec)) {
+                    string name = dir_entry.path().filename();
+                    string src = src_dir + "/" + name;
+                    string live = live_dir + "/" + name;
+                    string dst = staged_dir + "/" + name;
+
+                    if (std::find(excluded.begin(), excluded.end(), name) != excluded.end())
+                        continue;
+
+                    if (dir_entry.is_directory()) {
+                        err e = stage_tree(src, live, dst, {}, staged, stats);
+                        if (e != err::no_error)
+                            return e;
+                        continue;
+                    }
+
+                    struct stat src_stat;
+                    if (stat(src.c_str(), &src_stat) != 0 || !S_ISREG(src_stat.st_mode))
+                        continue;
+
+                    staged.insert(live);
+
+                    if (is_unchanged(src_stat, live) && link(live.c_str(), dst.c_str()) == 0) {
+                        stats.linked++;
+                        continue;
+                    }
+
+                    switch (copy_file(src, dst, src_stat)) {
+                    case COPY_CLONED:
+                        stats.cloned++;
+                        break;
+                    case COPY_COPIED:
+                        stats.copied++;
+                        break;
+                    default:
+                        cli::error("Unable to copy %s to %s", src, dst);
+                        return err::invalid_operation;
+                    }
+                }
+
+                if (ec) {
+                    cli::error("Unable to read directory: %s", src_dir);
+                    return err::invalid_operation;
+                }
+
+                return err::no_error;
+            }
+
+            int count_removed(const string& live_dir, const std::set<string>& staged)
+            {
+                int removed = 0;
+
+                std::error_code ec;
+                for (const auto& dir_entry : fs::recursive_directory_iterator(live_dir, ec)) {
+                    if (!dir_entry.is_directory() && staged.count(dir_entry.path().string()) == 0)
+                        removed++;
+                }
+
+                return removed;
+            }
+        }
+
+        err deploy_module(const std::vector<DeploySource>& sources, const string& module_path, DeployStats& stats)
+        {
+            fs::path live = module_path;
+            string staged_path = (live.parent_path() / ("." + live.filename().string() + ".deploy")).string();
+            string old_path = (live.parent_path() / ("." + live.filename().string() + ".old")).string();
+
+            // Left overs of an interrupted deploy
+            std::error_code ec;
+            fs::remove_all(staged_path, ec);
+            fs::remove_all(old_path, ec);
+
+            std::set<string> staged;
+            for (const auto& source : sources) {
+                string sub_dir = source.sub_dir.length() > 0 ? "/" + source.sub_dir : "";
+
+                err e = stage_tree(source.path, module_path + sub_dir, staged_path + sub_dir, source.excluded, staged, stats);
+                if (e != err::no_error) {
+                    fs::remove_all(staged_path, ec);
+                    return e;
+                }
+            }
+
+            bool exists = fs::exists(module_path, ec);
+            if (exists)
+                stats.removed = count_removed(module_path, staged);
+
+            if (!exists) {
+                if (std::rename(staged_path.c_str(), module_path.c_str()) != 0) {
+                    cli::error("Unable to create module: %s", module_path);
+                    fs::remove_all(staged_path, ec);
+                    return err::invalid_operation;
+                }
+
+                return err::no_error;
+            }
+
+            // Swap both trees at once, two renames leave a short gap where
+            // the module does not exist if the filesystem can not exchange
+            if (renameat2(AT_FDCWD, staged_path.c_str(), AT_FDCWD, module_path.c_str(), RENAME_EXCHANGE) == 0) {
+                fs::remove_all(staged_path, ec);
+                return err::no_error;
+            }
+
+            if (std::rename(module_path.c_str(), old_path.c_str()) != 0 ||
+                std::rename(staged_path.c_str(), module_path.c_str()) != 0) {
+                cli::error("Unable to replace module: %s", module_path);
+                fs::remove_all(staged_path, ec);
+                return err::invalid_operation;
+            }
+
+            fs::remove_all(old_path, ec);
+
+            return err::no_error;
+        }
+    } // namespace sdk
+} // namespace ltd
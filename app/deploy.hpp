@@ -0,0 +1,60 @@
+#ifndef _LTD_INCLUDE_DEPLOY_HPP_
+#define _LTD_INCLUDE_DEPLOY_HPP_
+
+#include <vector>
+
+#include "../inc/ltd/stddef.hpp"
+#include "../inc/ltd/err.hpp"
+
+namespace ltd
+{
+    namespace sdk
+    {
+        /**
+         * @brief
+         * A directory tree deployed into a module, i.e. the project `inc` into
+         * the module `inc`.
+         */
+        struct DeploySource
+        {
+            string path;            // Source directory.
+            string sub_dir;         // Destination relative to the module, empty for its root.
+            string_list excluded;   // Files directly in the directory that are not deployed.
+        };
+
+        /**
+         * @brief
+         * What a deploy did with the files of the module.
+         */
+        struct DeployStats
+        {
+            int linked  = 0;        // Unchanged, hard linked from the previous module.
+            int cloned  = 0;        // Changed, reflinked on a copy on write filesystem.
+            int copied  = 0;        // Changed, copied in the kernel or through a buffer.
+            int removed = 0;        // Gone from the sources, left out of the module.
+        };
+
+        /**
+         * @brief
+         * Update a module from its sources, atomically and without copying
+         * unchanged files.
+         *
+         * @details
+         * The new module is staged next to the live one. A file with the same
+         * size and modification time as in the live module is hard linked from
+         * there, any other file is reflinked where the filesystem supports it
+         * and copied with `copy_file_range` otherwise, keeping its modification
+         * time. Files that are no longer in the sources are simply not staged.
+         * The staged module is then exchanged with the live one in a single
+         * rename, so importing projects never see a half written module.
+         *
+         * Files are never linked to the sources themselves: an archive that is
+         * updated in place by the next build would change the module with it.
+         *
+         * @returns err::invalid_operation if the module can not be written.
+         */
+        err deploy_module(const std::vector<DeploySource>& sources, const string& module_path, DeployStats& stats);
+    } // namespace sdk
+} // namespace ltd
+
+#endif // _LTD_INCLUDE_DEPLOY_HPP_
@@ -0,0 +1,86 @@
+#include "hash.hpp"
+
+#include <cstdio>
+
+namespace ltd
+{
+    namespace sdk
+    {
+        namespace
+        {
+            // FNV-1a 128 bit parameters
+            const unsigned __int128 fnv_prime  = ((unsigned __int128)0x0000000001000000ULL << 64) | 0x000000000000013BULL;
+            const unsigned __int128 fnv_offset = ((unsigned __int128)0x6c62272e07bb0142ULL << 64) | 0x62b821756295c58dULL;
+        }
+
+        Hash::Hash() : state(fnv_offset)
+        {
+
+        }
+
+        void Hash::update(const void* data, size_t size)
+        {
+            auto bytes = static_cast<const unsigned char*>(data);
+
+            for (size_t i = 0; i < size; i++) {
+                state ^= bytes[i];
+                state *= fnv_prime;
+            }
+        }
+
+        void Hash::update(const string& text)
+        {
+            // Length prefix keeps ("ab","c") and ("a","bc") apart
+            update((uint64_t)text.size());
+            update(text.data(), text.size());
+        }
+
+        void Hash::update(uint64_t value)
+        {
+            update(&value, sizeof(value));
+        }
+
+        err Hash::update_file(const string& path)
+        {
+            FILE *file = std::fopen(path.c_str(), "rb");
+            if (file == nullptr)
+                return err::not_found;
+
+            char buffer[65536];
+            size_t count;
+
+            while ((count = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+                update(buffer, count);
+
+            std::fclose(file);
+
+            return err::no_error;
+        }
+
+        uint64_t Hash::value() const
+        {
+            return (uint64_t)state;
+        }
+
+        string Hash::hex() const
+        {
+            static const char digits[] = "0123456789abcdef";
+            string text(32, '0');
+
+            unsigned __int128 value = state;
+            for (int i = 31; i >= 0; i--) {
+                text[i] = digits[(int)(value & 0xf)];
+                value >>= 4;
+            }
+
+            return text;
+        }
+
+        uint64_t hash_string(const string& text)
+        {
+            Hash hash;
+            hash.update(text.data(), text.size());
+            return hash.value();
+        }
+    } // namespace sdk
+} // namespace ltd
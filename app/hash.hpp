@@ -0,0 +1,59 @@
+#ifndef _LTD_INCLUDE_HASH_HPP_
+#define _LTD_INCLUDE_HASH_HPP_
+
+#include <cstdint>
+
+#include "../inc/ltd/stddef.hpp"
+#include "../inc/ltd/err.hpp"
+
+namespace ltd
+{
+    namespace sdk
+    {
+        /**
+         * @brief
+         * Incremental 128 bit FNV-1a hash, used to fingerprint files, command
+         * lines and cache keys.
+         */
+        class Hash
+        {
+        private:
+            unsigned __int128 state;
+
+        public:
+            Hash();
+
+            void update(const void* data, size_t size);
+            void update(const string& text);
+            void update(uint64_t value);
+
+            /**
+             * @brief
+             * Hash the content of a file.
+             *
+             * @returns err::not_found if the file cannot be read.
+             */
+            err update_file(const string& path);
+
+            /**
+             * @brief
+             * Get the lower 64 bits of the hash.
+             */
+            uint64_t value() const;
+
+            /**
+             * @brief
+             * Get the hash as 32 hexadecimal characters.
+             */
+            string hex() const;
+        };
+
+        /**
+         * @brief
+         * Get the 64 bit hash of a string.
+         */
+        uint64_t hash_string(const string& text);
+    } // namespace sdk
+} // namespace ltd
+
+#endif // _LTD_INCLUDE_HASH_HPP_
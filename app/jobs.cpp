@@ -0,0 +1,548 @@
+#include "jobs.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../inc/ltd/cli.hpp"
+
+extern char **environ;
+
+namespace fs = std::filesystem;
+
+namespace ltd
+{
+    namespace sdk
+    {
+        namespace
+        {
+            // Expected peak and duration of a job that never ran and has no peers that did
+            const long    DEFAULT_JOB_MEMORY = 512 * 1024;
+            const int64_t DEFAULT_JOB_TIME = 1000000;
+
+            /**
+             * @brief
+             * Get the expected value of a field for every job of a queue. Jobs
+             * that never ran are expected to need what their peers of the same
+             * category needed on average.
+             */
+            template <typename Value>
+            std::vector<Value> expected_values(const Jobs& queue, Value Job::*field, Value fallback)
+            {
+                std::map<string, std::pair<Value, long>> known;   // Sum and count by category
+                for (const auto& job : queue) {
+                    if (job.*field > 0) {
+                        known[job.category].first += job.*field;
+                        known[job.category].second++;
+                    }
+                }
+
+                std::vector<Value> values(queue.size(), fallback);
+                for (size_t i = 0; i < queue.size(); i++) {
+                    auto found = known.find(queue[i].category);
+
+                    if (queue[i].*field > 0)
+                        values[i] = queue[i].*field;
+                    else if (found != known.end())
+                        values[i] = found->second.first / found->second.second;
+                }
+
+                return values;
+            }
+
+            // Reads a number of bytes, 'max' and the huge values of cgroup v1 are no limit
+            long read_memory_file(const string& path)
+            {
+                std::ifstream file(path);
+
+                string value;
+                if (!(file >> value) || value == "max")
+                    return 0;
+
+                long long bytes = std::atoll(value.c_str());
+                return bytes > 0 && bytes < (1LL << 50) ? (long)(bytes / 1024) : 0;
+            }
+
+            /**
+             * @brief
+             * Get the memory left below the limit of the cgroup of the process
+             * or of one of its parents, in KB.
+             *
+             * @returns 0 if there is no limit.
+             */
+            long get_cgroup_memory()
+            {
+                std::ifstream cgroups("/proc/self/cgroup");
+
+                long left = 0;
+                auto update = [&left](long limit, long usage) {
+                    if (limit > 0 && (left == 0 || limit - usage < left))
+                        left = std::max(limit - usage, 1L);
+                };
+
+                string line;
+                while (std::getline(cgroups, line)) {
+                    size_t first = line.find(':');
+                    size_t second = line.find(':', first + 1);
+                    if (first == string::npos || second == string::npos)
+                        continue;
+
+                    string controllers = line.substr(first + 1, second - first - 1);
+                    fs::path path = line.substr(second + 1);
+
+                    // The cgroup namespace of a container mounts its own cgroup as the root
+                    if (controllers.length() == 0) {
+                        for (fs::path dir = "/sys/fs/cgroup" + path.string(); ; dir = dir.parent_path()) {
+                            if (fs::exists(dir / "memory.max"))
+                                update(read_memory_file(dir / "memory.max"), read_memory_file(dir / "memory.current"));
+
+                            if (dir.string().length() <= string("/sys/fs/cgroup").length())
+                                break;
+                        }
+                    } else if (controllers == "memory") {
+                        for (fs::path dir : { fs::path("/sys/fs/cgroup/memory" + path.string()), fs::path("/sys/fs/cgroup/memory") }) {
+                            if (fs::exists(dir / "memory.limit_in_bytes")) {
+                                update(read_memory_file(dir / "memory.limit_in_bytes"), read_memory_file(dir / "memory.usage_in_bytes"));
+                                break;
+                            }
+                        }
+                    }
+                }
+
+                return left;
+            }
+        }
+
+        long get_available_memory()
+        {
+            long available = 0;
+
+            std::ifstream meminfo("/proc/meminfo");
+
+            string line;
+            while (std::getline(meminfo, line)) {
+                if (line.compare(0, 13, "MemAvailable:") == 0)
+                    available = std::atol(line.c_str() + 13);
+            }
+
+            long cgroup = get_cgroup_memory();
+            if (cgroup > 0 && (available == 0 || cgroup < available))
+                available = cgroup;
+
+            return available;
+        }
+
+        namespace
+        {
+            using JobRecord = std::pair<long, int64_t>;     // Peak memory and duration
+
+            std::map<string, JobRecord> read_job_history(const string& path)
+            {
+                std::map<string, JobRecord> records;
+
+                std::ifstream file(path);
+
+                string target;
+                long peak;
+                int64_t duration;
+                while (file >> target >> peak >> duration)
+                    records[target] = { peak, duration };
+
+                return records;
+            }
+        }
+
+        void load_job_history(const string& path, Jobs& queue)
+        {
+            auto records = read_job_history(path);
+
+            for (auto& job : queue) {
+                auto found = records.find(job.target);
+                if (found != records.end()) {
+                    job.expected_rss  = found->second.first;
+                    job.expected_time = found->second.second;
+                }
+            }
+        }
+
+        void save_job_history(const string& path, const Jobs& queue)
+        {
+            auto records = read_job_history(path);
+
+            bool changed = false;
+            for (const auto& job : queue) {
+                if (job.slot >= 0 && job.exit_code == 0 && job.target.length() > 0) {
+                    records[job.target] = { job.max_rss, job.end_time - job.start_time };
+                    changed = true;
+                }
+            }
+
+            if (!changed)
+                return;
+
+            std::ofstream out(path, std::ios::trunc);
+            for (const auto& [target, record] : records)
+                out << target << ' ' << record.first << ' ' << record.second << '\n';
+        }
+
+        int default_jobs()
+        {
+            int count = std::thread::hardware_concurrency();
+            return count > 0 ? count : 1;
+        }
+
+        int64_t steady_micros()
+        {
+            using namespace std::chrono;
+            return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+        }
+
+        int run_program(const string_list& args, Job& job)
+        {
+            if (args.size() == 0)
+                return -1;
+
+            int fds[2];
+            if (pipe2(fds, O_CLOEXEC) != 0) {
+                job.output += "Unable to create pipe for: " + args[0] + "\n";
+                return -1;
+            }
+
+            posix_spawn_file_actions_t actions;
+            posix_spawn_file_actions_init(&actions);
+            posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+            posix_spawn_file_actions_adddup2(&actions, fds[1], STDERR_FILENO);
+
+            std::vector<char*> argv;
+            for (const auto& arg : args)
+                argv.push_back(const_cast<char*>(arg.c_str()));
+            argv.push_back(nullptr);
+
+            pid_t pid;
+            int result = posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+
+            posix_spawn_file_actions_destroy(&actions);
+            close(fds[1]);
+
+            if (result != 0) {
+                close(fds[0]);
+                job.output += "Unable to start: " + args[0] + "\n";
+                return -1;
+            }
+
+            char buffer[4096];
+            ssize_t count;
+            while ((count = read(fds[0], buffer, sizeof(buffer))) != 0) {
+                if (count < 0) {
+                    if (errno == EINTR)
+                        continue;
+                    break;
+                }
+                job.output.append(buffer, count);
+            }
+            close(fds[0]);
+
+            int status = 0;
+            struct rusage usage;
+            while (wait4(pid, &status, 0, &usage) < 0) {
+                if (errno != EINTR)
+                    return -1;
+            }
+
+            job.user_time   += usage.ru_utime.tv_sec * 1000000 + usage.ru_utime.tv_usec;
+            job.system_time += usage.ru_stime.tv_sec * 1000000 + usage.ru_stime.tv_usec;
+            job.max_rss      = std::max(job.max_rss, usage.ru_maxrss);
+
+            if (WIFEXITED(status))
+                return WEXITSTATUS(status);
+
+            if (WIFSIGNALED(status))
+                return 128 + WTERMSIG(status);
+
+            return -1;
+        }
+
+        int run_process(const string& command, Job& job)
+        {
+            return run_program({ "/bin/sh", "-c", command }, job);
+        }
+
+        Job make_command_job(const string& name, const string& message, const string& command)
+        {
+            Job job;
+
+            job.name    = name;
+            job.message = message;
+            job.command = command;
+            job.action  = [command](Job& self) { return run_process(command, self); };
+
+            return job;
+        }
+
+        JobPool::JobPool(int max_jobs)
+        {
+            this->max_jobs = max_jobs > 0 ? max_jobs : 1;
+        }
+
+        int JobPool::get_max_jobs() const
+        {
+            return max_jobs;
+        }
+
+        int JobPool::get_remote_slots() const
+        {
+            return remote_slots;
+        }
+
+        void JobPool::set_remote_slots(int slots)
+        {
+            remote_slots = std::max(slots, 0);
+        }
+
+        int JobPool::get_max_links() const
+        {
+            return max_links;
+        }
+
+        void JobPool::set_max_links(int links)
+        {
+            max_links = links;
+        }
+
+        long JobPool::get_memory_budget() const
+        {
+            return memory_budget;
+        }
+
+        void JobPool::set_memory_budget(long budget)
+        {
+            memory_budget = budget;
+        }
+
+        std::shared_ptr<JobServer> JobPool::get_job_server() const
+        {
+            return job_server;
+        }
+
+        void JobPool::set_job_server(std::shared_ptr<JobServer> server)
+        {
+            job_server = server;
+        }
+
+        err JobPool::run(Jobs& queue) const
+        {
+            using Finished = std::pair<int, std::size_t>;   // Worker slot and job index
+
+            std::mutex mutex;
+            std::condition_variable done;
+            std::vector<Finished> finished;
+
+            std::vector<std::thread> workers(max_jobs + remote_slots);
+            std::vector<bool> busy(max_jobs + remote_slots, false);
+
+            // Count unfinished dependencies and collect the reverse edges
+            std::vector<size_t> waiting(queue.size(), 0);
+            std::vector<JobIds> dependents(queue.size());
+
+            for (size_t i = 0; i < queue.size(); i++) {
+                waiting[i] = queue[i].deps.size();
+                for (auto dep : queue[i].deps)
+                    dependents[dep].push_back(i);
+            }
+
+            std::vector<long> memory = expected_values(queue, &Job::expected_rss, DEFAULT_JOB_MEMORY);
+            std::vector<int64_t> duration = expected_values(queue, &Job::expected_time, DEFAULT_JOB_TIME);
+
+            // Longest expected time from the start of a job to the end of the build
+            std::vector<int64_t> critical(queue.size(), -1);
+
+            std::function<int64_t(size_t)> critical_path = [&](size_t index) {
+                if (critical[index] < 0) {
+                    int64_t longest = 0;
+                    for (auto dependent : dependents[index])
+                        longest = std::max(longest, critical_path(dependent));
+
+                    critical[index] = duration[index] + longest;
+                }
+
+                return critical[index];
+            };
+
+            for (size_t i = 0; i < queue.size(); i++)
+                critical_path(i);
+
+            // The jobs gating the longest chains start first, a long job started last would end last
+            auto first = [&critical](size_t a, size_t b) {
+                return critical[a] != critical[b] ? critical[a] > critical[b] : a < b;
+            };
+
+            std::set<size_t, decltype(first)> ready(first);
+            for (size_t i = 0; i < queue.size(); i++) {
+                if (waiting[i] == 0)
+                    ready.insert(i);
+            }
+
+            auto is_link = [&queue](size_t index) { return queue[index].category == "link"; };
+            auto is_compile = [&queue](size_t index) { return queue[index].category == "compile"; };
+
+            int running = 0;
+            int local = 0;                  // Running jobs on the local slots
+            int links = 0;
+            long reserved = 0;
+            bool failed = false;
+
+            std::vector<char> tokens;       // Jobserver tokens of the running local jobs but one
+            std::vector<bool> remote(queue.size(), false);
+            bool waiting_token = false;
+
+            while (running > 0 || (!failed && ready.size() > 0)) {
+                // Fill up free worker slots
+                while (!failed && ready.size() > 0 && running < max_jobs + remote_slots) {
+                    bool on_remote = local >= max_jobs;
+
+                    // The first ready job within the link and memory limits, one job always runs
+                    auto candidate = ready.begin();
+                    for (; candidate != ready.end(); candidate++) {
+                        if (on_remote) {
+                            if (is_compile(*candidate))
+                                break;
+                            continue;
+                        }
+
+                        if (max_links > 0 && links >= max_links && is_link(*candidate))
+                            continue;
+
+                        if (memory_budget > 0 && local > 0 && reserved + memory[*candidate] > memory_budget)
+                            continue;
+
+                        break;
+                    }
+
+                    if (candidate == ready.end())
+                        break;
+
+                    // Every local job but one needs a token of the jobserver
+                    if (job_server && !on_remote && local > 0) {
+                        char token;
+                        if (!job_server->try_acquire(token)) {
+                            waiting_token = true;
+                            break;
+                        }
+
+                        tokens.push_back(token);
+                    }
+
+                    size_t next = *candidate;
+                    ready.erase(candidate);
+
+                    remote[next] = on_remote;
+                    if (!on_remote) {
+                        local++;
+                        reserved += memory[next];
+                    }
+
+                    if (is_link(next))
+                        links++;
+
+                    int slot = 0;
+                    while (busy[slot])
+                        slot++;
+
+                    Job& job = queue[next];
+                    if (job.message.length() > 0)
+                        cli::vprintln(job.message_level, job.message);
+                    if (job.command.length() > 0)
+                        cli::trace(job.command);
+
+                    busy[slot] = true;
+                    workers[slot] = std::thread([&, slot, index = next]() {
+                        Job& job = queue[index];
+
+                        job.slot       = slot;
+                        job.start_time = steady_micros();
+                        job.exit_code  = job.action(job);
+                        job.end_time   = steady_micros();
+
+                        std::lock_guard<std::mutex> lock(mutex);
+                        finished.emplace_back(slot, index);
+                        done.notify_one();
+                    });
+
+                    running++;
+                }
+
+                if (running == 0)
+                    break;
+
+                std::vector<Finished> completed;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    auto has_finished = [&finished]() { return finished.size() > 0; };
+
+                    // Tokens returned by other processes are not signalled, they are polled for
+                    if (waiting_token)
+                        done.wait_for(lock, std::chrono::milliseconds(20), has_finished);
+                    else
+                        done.wait(lock, has_finished);
+
+                    completed.swap(finished);
+                    waiting_token = false;
+                }
+
+                // Output is only written from this thread, one job at a time
+                for (auto [slot, index] : completed) {
+                    workers[slot].join();
+                    busy[slot] = false;
+                    running--;
+
+                    if (!remote[index]) {
+                        local--;
+                        reserved -= memory[index];
+                    }
+
+                    if (is_link(index))
+                        links--;
+
+                    if (tokens.size() > 0 && tokens.size() >= (size_t)local) {
+                        job_server->release(tokens.back());
+                        tokens.pop_back();
+                    }
+
+                    Job& job = queue[index];
+                    if (job.output.length() > 0) {
+                        std::cout << job.output;
+                        std::cout.flush();
+                    }
+
+                    if (job.exit_code != 0) {
+                        cli::error("Failed: %s (exit code %d)", job.name, job.exit_code);
+                        failed = true;
+                        continue;
+                    }
+
+                    for (auto dependent : dependents[index]) {
+                        if (--waiting[dependent] == 0)
+                            ready.insert(dependent);
+                    }
+                }
+            }
+
+            return failed ? err::invalid_operation : err::no_error;
+        }
+    } // namespace sdk
+} // namespace ltd
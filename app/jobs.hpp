@@ -0,0 +1,203 @@
+#ifndef _LTD_INCLUDE_JOBS_HPP_
+#define _LTD_INCLUDE_JOBS_HPP_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "../inc/ltd/stddef.hpp"
+#include "../inc/ltd/err.hpp"
+#include "../inc/ltd/cli.hpp"
+
+#include "jobserver.hpp"
+
+namespace ltd
+{
+    namespace sdk
+    {
+        /**
+         * @brief
+         * A unit of work executed by the job pool, usually a single compiler,
+         * archiver or linker invocation.
+         */
+        struct Job
+        {
+            using Action = std::function<int(Job&)>;
+
+            string name;                // Short name used when reporting failures.
+            string message;             // Progress message printed when the job starts.
+            int    message_level = cli::LOG_DEBUG;
+            string command;             // Command line printed in trace mode.
+            string target;              // The file produced by the job.
+            Action action;              // The work itself, returns the exit code.
+
+            std::vector<size_t> deps;   // Jobs that need to succeed before this one starts.
+
+            string category;            // Kind of step in the build trace, i.e. 'compile'.
+
+            string output;              // Captured stdout and stderr of the job.
+            int    exit_code = 0;       // Exit code of the job.
+
+            int     slot = -1;          // Worker slot the job ran on.
+            int64_t start_time = 0;     // Steady clock time in microseconds.
+            int64_t end_time = 0;
+            int64_t user_time = 0;      // CPU time of the processes in microseconds.
+            int64_t system_time = 0;
+            long    max_rss = 0;        // Peak resident set size of the processes in KB.
+            long    expected_rss = 0;   // Peak resident set size of the last run in KB, 0 if unknown.
+            int64_t expected_time = 0;  // Duration of the last run in microseconds, 0 if unknown.
+        };
+
+        using Jobs   = std::vector<Job>;
+        using JobIds = std::vector<size_t>;
+
+        /**
+         * @brief
+         * Get the default number of parallel jobs, the hardware concurrency.
+         */
+        int default_jobs();
+
+        /**
+         * @brief
+         * Get the memory available to new processes in KB: `MemAvailable` of
+         * `/proc/meminfo`, or less when the cgroup of the process has a lower
+         * limit left.
+         *
+         * @returns 0 if the memory can not be determined.
+         */
+        long get_available_memory();
+
+        /**
+         * @brief
+         * Set the expected peak memory and duration of the jobs in a queue from
+         * a file of earlier runs, with one `<target> <KB> <microseconds>` line
+         * per job target.
+         */
+        void load_job_history(const string& path, Jobs& queue);
+
+        /**
+         * @brief
+         * Record the peak memory and duration of the jobs in a queue that
+         * succeeded, keeping the records of the jobs that did not run.
+         */
+        void save_job_history(const string& path, const Jobs& queue);
+
+        /**
+         * @brief
+         * Get the steady clock time in microseconds, the time base of the job
+         * start and end times.
+         */
+        int64_t steady_micros();
+
+        /**
+         * @brief
+         * Run a shell command and append its stdout and stderr to the job output.
+         * The CPU time and peak memory of the command are added to the job.
+         *
+         * @returns The exit code of the command, 128 + signal number if the
+         *          command was killed by a signal.
+         */
+        int run_process(const string& command, Job& job);
+
+        /**
+         * @brief
+         * Run a program with its arguments, without a shell, the program is
+         * searched in `PATH`. Its output and usage are added as by run_process.
+         *
+         * @returns The exit code of the program, -1 if it could not be started.
+         */
+        int run_program(const string_list& args, Job& job);
+
+        /**
+         * @brief
+         * Create a job that runs a single shell command.
+         */
+        Job make_command_job(const string& name, const string& message, const string& command);
+
+        /**
+         * @brief
+         * Runs jobs concurrently on a bounded number of workers.
+         *
+         * @details
+         * The jobs form a dependency graph: a job is started as soon as all of
+         * its dependencies succeeded and a worker is free. Ready jobs on the
+         * longest path of expected durations to the end of the build start
+         * first, the queue order breaks ties. The output of each job is 
+         * buffered and printed as a whole when the job finishes, so lines of
+         * concurrent jobs never interleave. When a job fails no new jobs are
+         * started, the running jobs are waited for and the failure is reported.
+         *
+         * With a memory budget a job only starts while the expected peak memory
+         * of the running jobs and its own fits the budget, unless nothing else
+         * runs. Jobs without an expected peak count with the average of the
+         * known ones of their category, the same goes for the durations of jobs
+         * that never ran. A ready job that does not fit lets the smaller ones
+         * after it start first.
+         *
+         * With a jobserver the jobs also share the job slots with the other
+         * processes of the jobserver.
+         */
+        class JobPool
+        {
+        private:
+            int max_jobs;
+            int remote_slots = 0;       // Compile jobs running on compile workers on top of max_jobs.
+            int max_links = 0;          // Link jobs running at once, 0 for no limit.
+            long memory_budget = 0;     // Memory of the running jobs in KB, 0 for no limit.
+            std::shared_ptr<JobServer> job_server;
+
+        public:
+            JobPool(int max_jobs);
+
+            int get_max_jobs() const;
+
+            int get_remote_slots() const;
+
+            /**
+             * @brief
+             * Run up to `slots` compile jobs on top of the local jobs, while
+             * the local slots are full. They compile on compile workers, so
+             * they take no memory of the budget and no jobserver token.
+             */
+            void set_remote_slots(int slots);
+
+            int get_max_links() const;
+
+            /**
+             * @brief
+             * Limit the jobs of the `link` category running at once, links
+             * need the most memory and do not gain much from each other.
+             */
+            void set_max_links(int links);
+
+            long get_memory_budget() const;
+
+            /**
+             * @brief
+             * Limit the expected peak memory of the running jobs, in KB.
+             */
+            void set_memory_budget(long budget);
+
+            std::shared_ptr<JobServer> get_job_server() const;
+
+            /**
+             * @brief
+             * Take a token of a jobserver for every job started while another
+             * one runs, the first job runs on the slot of the process.
+             */
+            void set_job_server(std::shared_ptr<JobServer> server);
+
+            /**
+             * @brief
+             * Run all jobs in the queue. Dependencies have to refer to jobs in
+             * the same queue.
+             *
+             * @returns err::no_error when all jobs succeeded.
+             */
+            err run(Jobs& queue) const;
+        };
+    } // namespace sdk
+} // namespace ltd
+
+#endif // _LTD_INCLUDE_JOBS_HPP_
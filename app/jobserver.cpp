@@ -0,0 +1,155 @@
+#include "jobserver.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../inc/ltd/cli.hpp"
+#include "../inc/ltd/fmt.hpp"
+
+namespace ltd
+{
+    namespace sdk
+    {
+        namespace
+        {
+            // A descriptor of its own on the same pipe, so it can be made non blocking
+            int reopen_non_blocking(int fd)
+            {
+                return open(fmt::sprintf("/proc/self/fd/%d", fd).c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+            }
+        }
+
+        JobServer::~JobServer()
+        {
+            if (read_fd >= 0)
+                close(read_fd);
+
+            if (!served)
+                return;
+
+            close(pipe_fds[0]);
+            close(pipe_fds[1]);
+
+            if (had_makeflags)
+                setenv("MAKEFLAGS", makeflags.c_str(), 1);
+            else
+                unsetenv("MAKEFLAGS");
+        }
+
+        err JobServer::attach(const string& makeflags)
+        {
+            // The last option wins, as for make
+            string auth;
+            for (const auto& flag : split(makeflags, " ")) {
+                if (flag.compare(0, 17, "--jobserver-auth=") == 0)
+                    auth = flag.substr(17);
+                else if (flag.compare(0, 16, "--jobserver-fds=") == 0)
+                    auth = flag.substr(16);
+            }
+
+            if (auth.length() == 0)
+                return err::not_found;
+
+            if (auth.compare(0, 5, "fifo:") == 0) {
+                string path = auth.substr(5);
+
+                read_fd = open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+                if (read_fd < 0) {
+                    cli::warn("Unable to open the jobserver fifo: %s", path);
+                    return err::invalid_state;
+                }
+
+                write_fd = read_fd;
+                return err::no_error;
+            }
+
+            size_t comma = auth.find(',');
+            if (comma == string::npos)
+                return err::not_found;
+
+            int fds[2] = { std::atoi(auth.c_str()), std::atoi(auth.c_str() + comma + 1) };
+
+            // Make closes the descriptors for commands it does not consider recursive
+            if (fds[0] < 0 || fds[1] < 0 || fcntl(fds[0], F_GETFD) < 0 || fcntl(fds[1], F_GETFD) < 0) {
+                cli::warn("The jobserver of make is not available, mark the rule running ltd with '+'");
+                return err::invalid_state;
+            }
+
+            read_fd = reopen_non_blocking(fds[0]);
+            if (read_fd < 0)
+                return err::invalid_state;
+
+            write_fd = fds[1];
+
+            return err::no_error;
+        }
+
+        err JobServer::serve(int slots)
+        {
+            // Not close on exec, the children use the pipe
+            if (pipe(pipe_fds) != 0)
+                return err::invalid_operation;
+
+            read_fd = reopen_non_blocking(pipe_fds[0]);
+            if (read_fd < 0) {
+                close(pipe_fds[0]);
+                close(pipe_fds[1]);
+                return err::invalid_operation;
+            }
+
+            write_fd = pipe_fds[1];
+            served = true;
+
+            // The build itself holds the one slot without a token
+            for (int i = 1; i < slots; i++)
+                release('+');
+
+            const char* current = getenv("MAKEFLAGS");
+            had_makeflags = current != nullptr;
+            makeflags = had_makeflags ? current : "";
+
+            string flags = fmt::sprintf("-j%d --jobserver-auth=%d,%d", slots, pipe_fds[0], pipe_fds[1]);
+            if (makeflags.length() > 0)
+                flags = makeflags + " " + flags;
+
+            setenv("MAKEFLAGS", flags.c_str(), 1);
+
+            return err::no_error;
+        }
+
+        bool JobServer::is_active() const
+        {
+            return read_fd >= 0;
+        }
+
+        bool JobServer::is_served() const
+        {
+            return served;
+        }
+
+        bool JobServer::try_acquire(char& token)
+        {
+            if (read_fd < 0)
+                return false;
+
+            ssize_t count;
+            do {
+                count = read(read_fd, &token, 1);
+            } while (count < 0 && errno == EINTR);
+
+            return count == 1;
+        }
+
+        void JobServer::release(char token)
+        {
+            ssize_t count;
+            do {
+                count = write(write_fd, &token, 1);
+            } while (count < 0 && errno == EINTR);
+        }
+    } // namespace sdk
+} // namespace ltd
@@ -0,0 +1,92 @@
+#ifndef _LTD_INCLUDE_JOBSERVER_HPP_
+#define _LTD_INCLUDE_JOBSERVER_HPP_
+
+#include "../inc/ltd/stddef.hpp"
+#include "../inc/ltd/err.hpp"
+
+namespace ltd
+{
+    namespace sdk
+    {
+        /**
+         * @brief
+         * The GNU make jobserver: a pipe or named fifo holding one byte, a
+         * token, for every job slot that processes sharing it may use on top
+         * of the one slot each of them has without a token.
+         *
+         * @details
+         * As a client, the jobserver is the one a parent make advertises in
+         * `MAKEFLAGS` with `--jobserver-auth=R,W`, `--jobserver-fds=R,W` or
+         * `--jobserver-auth=fifo:PATH`. As a server, a pipe is created with
+         * the tokens of the build and advertised in `MAKEFLAGS` to the
+         * processes started meanwhile, i.e. make or the `-flto=auto` link
+         * steps of gcc.
+         *
+         * Tokens are read from a descriptor of its own, opened non blocking,
+         * so waiting for a token never blocks the descriptors others share.
+         */
+        class JobServer
+        {
+        private:
+            int read_fd = -1;       // Non blocking descriptor the tokens are read from.
+            int write_fd = -1;      // Descriptor the tokens are returned to.
+            int pipe_fds[2] = { -1, -1 };   // Pipe of the server, inherited by the children.
+
+            bool served = false;
+            bool had_makeflags = false;
+            string makeflags;       // MAKEFLAGS before the server advertised itself.
+
+        public:
+            JobServer() = default;
+            JobServer(const JobServer&) = delete;
+            JobServer& operator=(const JobServer&) = delete;
+
+            /**
+             * @brief
+             * Close the jobserver, a server also restores `MAKEFLAGS`.
+             */
+            ~JobServer();
+
+            /**
+             * @brief
+             * Use the jobserver advertised in `MAKEFLAGS`.
+             *
+             * @returns err::not_found if no jobserver is advertised.
+             * @returns err::invalid_state if the advertised descriptors are not
+             *          open, the parent make did not pass them on.
+             */
+            err attach(const string& makeflags);
+
+            /**
+             * @brief
+             * Create a jobserver with `slots` job slots and advertise it to the
+             * child processes in `MAKEFLAGS`.
+             *
+             * @returns err::invalid_operation if the pipe can not be created.
+             */
+            err serve(int slots);
+
+            bool is_active() const;
+
+            /**
+             * @brief
+             * Check whether the jobserver was created by this process.
+             */
+            bool is_served() const;
+
+            /**
+             * @brief
+             * Take a token if one is free, without waiting.
+             */
+            bool try_acquire(char& token);
+
+            /**
+             * @brief
+             * Return a token, it has to be returned as it was taken.
+             */
+            void release(char token);
+        };
+    } // namespace sdk
+} // namespace ltd
+
+#endif // _LTD_INCLUDE_JOBSERVER_HPP_
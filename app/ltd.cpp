@@ -1,4 +1,6 @@
 #include <algorithm>
+#include <cstdlib>
+#include <filesystem>
 #include <iostream>
 #include <variant>
 
@@ -7,12 +9,24 @@
 #include "../inc/ltd/stddef.hpp"
 
 #include "sdk.hpp"
+#include "bench.hpp"
+#include "cache.hpp"
+#include "compiler.hpp"
+#include "jobs.hpp"
+#include "tester.hpp"
+#include "watch.hpp"
+#include "worker.hpp"
 
 using namespace ltd;
 
-void cmd_deploy(int global)
+err cmd_deploy(int global, const string& profile)
 {
-    sdk::deploy_to_module_path();
+    if (sdk::get_active_project().length() == 0) {
+        cli::error("Active project is not set.");
+        return err::invalid_state;
+    }
+
+    return sdk::deploy_to_module_path(profile);
 }
 
 void cmd_ls()
@@ -105,40 +119,151 @@ void cmd_pwd()
     fmt::println(sdk::get_active_project());
 }
 
-void cmd_build(bool debug, string_list& imports)
+err cmd_build(const sdk::BuildOptions& options)
 {
     auto active_project = sdk::get_active_project();
     
     // We need to have active project set
     if (active_project.length() == 0) {
         cli::error("Active project is not set.");
-        return;
+        return err::invalid_state;
     }
 
-    // Iterate project dir to get build targets
-    string_list dirs;
-    sdk::list_project_dir(dirs);
-
-    for (auto dir : dirs) {
-        if (dir == "app") {
-            sdk::build_dir(active_project, "/app", debug, imports);
-        } else if (dir == "lib") {
-            sdk::build_dir(active_project, "/lib", debug, imports);
-        } else if (dir == "tests") {
-            sdk::build_dir(active_project, "/tests", debug, imports);
-        } else if (dir == "apps") {
-            cli::fatal("Needs to implement apps");
-            exit(-1);
-        } else if (dir == "libs") {
-            cli::fatal("Needs to implement libs");
-            exit(-1);
+    if (sdk::build_project(options) != err::no_error) {
+        cli::error("Build failed.");
+        return err::invalid_operation;
+    }
+
+    return err::no_error;
+}
+
+err cmd_pgo_build(const sdk::BuildOptions& options, const string& train, const string& train_args)
+{
+    if (sdk::get_active_project().length() == 0) {
+        cli::error("Active project is not set.");
+        return err::invalid_state;
+    }
+
+    if (sdk::pgo_build_project(options, train, train_args) != err::no_error) {
+        cli::error("Build failed.");
+        return err::invalid_operation;
+    }
+
+    return err::no_error;
+}
+
+err cmd_watch(const sdk::BuildOptions& options, const string& run, const string& run_args, bool test)
+{
+    if (sdk::get_active_project().length() == 0) {
+        cli::error("Active project is not set.");
+        return err::invalid_state;
+    }
+
+    sdk::WatchOptions watch_options;
+    watch_options.run      = run;
+    watch_options.run_args = run_args;
+    watch_options.test     = test;
+
+    return sdk::watch_project(options, watch_options);
+}
+
+err cmd_test(const string& profile, int jobs, bool use_cache, const string& shard, bool affected, const string& since)
+{
+    sdk::TestOptions test_options;
+    test_options.jobs = jobs;
+
+    if (shard.length() > 0 && sdk::parse_shard(shard, test_options) != err::no_error)
+        return err::invalid_argument;
+
+    auto build_path = sdk::get_active_build_path(profile);
+
+    auto binaries = sdk::list_test_binaries(build_path + "/tests");
+    if (binaries.size() == 0) {
+        cli::warn("No unit tests found, build the project first.");
+        return err::no_error;
+    }
+
+    if (affected || since.length() > 0) {
+        if (sdk::select_affected_tests(build_path, sdk::get_active_project_path(), since, binaries) != err::no_error)
+            return err::invalid_argument;
+
+        if (binaries.size() == 0) {
+            fmt::println("No tests affected by the changes.");
+            return err::no_error;
         }
     }
+
+    if (use_cache) {
+        test_options.cache_path = build_path + "/.ltd_tests";
+
+        // Data files a test reads are listed in ltd.conf as '<test>.data'
+        sdk::ProjectConfig config;
+        sdk::get_project_config(config);
+
+        auto project_path = sdk::get_active_project_path();
+        for (const auto& binary : binaries) {
+            string name = fs::path(binary).filename();
+            for (const auto& input : config.get_list(name + ".data"))
+                test_options.data[name].push_back(project_path + "/" + input);
+        }
+    }
+
+    err result = sdk::run_tests(binaries, test_options);
+
+    // Unaffected tests passed before, so a passing selection is as good as a full run
+    if (result == err::no_error && test_options.shard_count == 1 && since.length() == 0)
+        sdk::record_tests_passed(build_path);
+
+    return result;
+}
+
+err cmd_bench(sdk::BuildOptions options, sdk::BenchOptions bench_options)
+{
+    // Timings of other profiles would not compare with the history
+    options.profile = "release";
+
+    if (cmd_build(options) != err::no_error)
+        return err::invalid_operation;
+
+    auto binaries = sdk::list_test_binaries(sdk::get_active_build_path(options.profile) + "/bench");
+    if (binaries.size() == 0) {
+        cli::warn("No benchmarks found, add them to the bench directory.");
+        return err::no_error;
+    }
+
+    bench_options.history_path = sdk::get_builds_path() + "/" + sdk::get_active_project() + "/bench-history";
+
+    return sdk::run_benchmarks(binaries, bench_options);
 }
 
-void cmd_clean(bool debug) 
+void cmd_clean(const string& profile) 
 {
-    sdk::clean_project(debug);
+    sdk::clean_project(profile);
+}
+
+void cmd_cache(cli& args, long cache_size)
+{
+    sdk::ObjectCache cache(sdk::get_cache_path());
+
+    auto [action, e] = args.at(1);
+
+    if (e == err::no_error && action == "clean") {
+        int removed = cache.clear();
+
+        // Header unit BMIs are cached next to the objects
+        std::error_code ec;
+        fs::remove_all(sdk::get_cache_path() + "/bmi", ec);
+
+        fmt::println("Removed %d cached objects", removed);
+        return;
+    }
+
+    int entries = 0;
+    uintmax_t size = 0;
+    cache.get_usage(entries, size);
+
+    string limit = cache_size > 0 ? fmt::sprintf("%d MB", (int)cache_size) : "no limit";
+    fmt::println("%s: %d objects, %d MB of %s", cache.get_cache_dir(), entries, (int)(size / (1024 * 1024)), limit);
 }
 
 void print_usage()
@@ -158,38 +283,111 @@ auto main(int argc, char *argv[]) -> int {
     int verbosity   = 0;
     int debug_mode  = 0;
     int global      = 0;
+    int jobs        = sdk::default_jobs();
+    int no_cache    = 0;
+    int unity       = 0;
+    int thin        = 0;
+    int lto         = 0;
+    int pgo         = 0;
+    int run_tests   = 0;
+    int affected    = 0;
+    int trials      = 10;
+    int cpu         = -1;
+    int accept      = 0;
+    int local_workers = 0;
+    int memory      = 0;
 
     string cppstd;
+    string profile;
+    string linker;
+    string trace;
     string run;
     string run_args;
+    string shard;
+    string since;
+    string workers;
+    string listen;
     
     string_list imports;
 
     args.bind_flag(verbosity, 'v', "Sets verbosity level 1-4");
-    args.bind_flag(debug_mode, 'g', "Debug mode");
+    args.bind_flag(debug_mode, 'g', "Debug mode, same as --profile=debug");
     args.bind_flag(global, 'G', "Deploy the module globally");
 
     args.bind_param(cppstd, "std", "Specifies cpp standards");
+    args.bind_param(profile, "profile", "Build profile: debug, release, relwithdebinfo, native");
     args.bind_param(imports, "imports", "List of imports to link with the project");
+    args.bind_param(jobs, 'j', "jobs", "Number of parallel build jobs");
+    args.bind_param(no_cache, "no-cache", "Do not use the object and test result caches");
+    args.bind_param(unity, "unity", -1, "Compile sources in unity batches of N files");
+    args.bind_param(thin, "thin", "Create thin library archives");
+    args.bind_param(lto, "lto", "Link time optimization with section GC and ICF");
+    args.bind_param(pgo, "pgo", "Profile guided build, trained with --run or the tests");
+    args.bind_param(linker, "linker", "Linker to use: auto, default, mold, lld, gold");
+    args.bind_param(trace, "trace", "Write a Chrome trace of the build steps to a file");
+    args.bind_param(memory, "memory", "Memory budget of the build jobs in MB, the available memory by default");
 
     args.bind_param(run, "run", "Specify executable to run after build");
     args.bind_param(run_args, "args", "Specify arguments for running executable");
+    args.bind_param(shard, "shard", "Run only shard i of n of the test cases, i.e. 2/4");
+    args.bind_param(workers, "workers", "Comma separated compile workers, Unix socket paths or host:port");
+    args.bind_param(local_workers, "local-workers", "Spawn N local compile workers for the build");
+    args.bind_param(listen, "listen", "Address ltd worker listens on, a Unix socket path or host:port");
+    args.bind_param(affected, "affected", "Only run the tests affected by changes since the last passing run");
+    args.bind_param(since, "since", "Only run the tests affected by changes since a git revision");
+    args.bind_param(run_tests, "test", "Run the relinked unit tests after every watch build");
+    args.bind_param(trials, "trials", "Number of timed runs of every benchmark");
+    args.bind_param(cpu, "cpu", "CPU the benchmarks are pinned to, the last one by default");
+    args.bind_param(accept, "accept", "Accept slower benchmark results as the new baseline");
 
     args.add_command("ls",  sdk::CMD_LS, "List all projects in the workspace");
     args.add_command("pwd", sdk::CMD_PWD, "Show currect active project");
     args.add_command("cd",  sdk::CMD_CD, "Change project directory");
     
     args.add_command("build", sdk::CMD_BUILD, "Build the current active project");
+    args.add_command("watch", sdk::CMD_WATCH, "Rebuild the active project on every change");
     args.add_command("clean", sdk::CMD_CLEAN, "Clean the current active project");
     args.add_command("test",  sdk::CMD_TEST, "Run tests");
+    args.add_command("bench", sdk::CMD_BENCH, "Build and run the benchmarks, failing on regressions");
+    args.add_command("worker", sdk::CMD_WORKER, "Compile for the builds of other machines.");
     args.add_command("deploy", sdk::CMD_DEPLOY, "Deploy the project as importable modules.");
     args.add_command("help",  sdk::CMD_HELP, "Show this help");
 
     args.add_command("get", sdk::CMD_GET, "Get some information and display it.");
+    args.add_command("cache", sdk::CMD_CACHE, "Show the object cache size, 'ltd cache clean' empties it.");
+
+    // A mistyped value would otherwise build with the default
+    if (args.parse() != err::no_error)
+        return -1;
 
-    args.parse();
+    // Worker addresses depend on the machine rather than the project
+    if (workers.length() == 0 && getenv("LTD_WORKERS") != NULL)
+        workers = getenv("LTD_WORKERS");
+
+    // So does the size of the cache, which all projects share
+    long cache_size = sdk::DEFAULT_CACHE_SIZE;
+    if (getenv("LTD_CACHE_SIZE") != NULL)
+        cache_size = std::atol(getenv("LTD_CACHE_SIZE"));
 
     cli::set_log_level(verbosity + cli::LOG_WARN);
+
+    profile = sdk::get_active_profile(debug_mode ? "debug" : profile);
+
+    sdk::BuildOptions options;
+    options.profile       = profile;
+    options.jobs          = jobs;
+    options.use_cache     = no_cache == 0;
+    options.cache_size    = cache_size;
+    options.unity         = unity < 0 ? sdk::DEFAULT_UNITY_SIZE : unity;
+    options.thin_archives = thin > 0;
+    options.lto           = lto > 0;
+    options.linker        = linker;
+    options.trace         = trace;
+    options.standard      = cppstd;
+    options.imports       = imports;
+    options.workers       = sdk::parse_worker_addresses(workers);
+    options.local_workers = local_workers;
+    options.memory        = memory;
     
     switch(args.get_command())
     {
@@ -203,11 +401,21 @@ auto main(int argc, char *argv[]) -> int {
         cmd_cd(args);
         break;
     case sdk::CMD_BUILD:
-        cmd_build(debug_mode, imports);
-        if (run.length() > 0) {
-            string run_path = sdk::get_homepath() + "/builds/" + sdk::get_active_project() + "/";
+        {
+            // The --run executable is the training run of a PGO build
+            if (pgo > 0) {
+                if (cmd_pgo_build(options, run, run_args) != err::no_error)
+                    return -1;
+
+                break;
+            }
 
-            run_path += debug_mode ? "debug/target" : "release/target";
+            if (cmd_build(options) != err::no_error)
+                return -1;
+        }
+
+        if (run.length() > 0) {
+            string run_path = sdk::get_active_build_path(profile) + "/target";
 
             string run_cmd = fmt::sprintf("%s/%s %s", run_path, run, run_args);
             fmt::println(run_cmd);
@@ -215,37 +423,42 @@ auto main(int argc, char *argv[]) -> int {
         }
 
         break;
+    case sdk::CMD_WATCH:
+        if (cmd_watch(options, run, run_args, run_tests > 0) != err::no_error)
+            return -1;
+        break;
     case sdk::CMD_CLEAN:
-        cmd_clean(debug_mode);
+        cmd_clean(profile);
+        break;
+    case sdk::CMD_WORKER:
+        if (sdk::run_worker(listen.length() > 0 ? listen : sdk::get_homepath() + "/worker.sock", sdk::get_default_compiler(), jobs) != err::no_error)
+            return -1;
         break;
     case sdk::CMD_TEST:
+        if (cmd_test(profile, jobs, no_cache == 0, shard, affected > 0, since) != err::no_error)
+            return -1;
+        break;
+    case sdk::CMD_BENCH:
         {
-            auto mode = debug_mode ? "/debug/" : "/release/";
-            auto path = sdk::get_homepath() + "/builds/" + sdk::get_active_project() + mode + "tests/";
-
-            for(const auto& dir_entry : fs::directory_iterator(path))  {
-                if (dir_entry.is_directory())
-                    continue;
-
-                if (dir_entry.path().extension() == ".o")
-                    continue;
-                
-                auto filename = dir_entry.path().filename().replace_extension("");
-                fmt::printf("Running unit test %-13s ........................ ", filename);
-                std::cout.flush();
-
-                auto exec = dir_entry.path();
-                exec += " -a";
-                auto res = std::system(exec.c_str());
-            }
+            sdk::BenchOptions bench_options;
+            bench_options.trials = trials;
+            bench_options.cpu    = cpu;
+            bench_options.accept = accept > 0;
+
+            if (cmd_bench(options, bench_options) != err::no_error)
+                return -1;
         }
         break;
     case sdk::CMD_DEPLOY:
-        cmd_deploy(global);
+        if (cmd_deploy(global, profile) != err::no_error)
+            return -1;
         break;
     case sdk::CMD_GET:
         cmd_get(args);
         break;
+    case sdk::CMD_CACHE:
+        cmd_cache(args, cache_size);
+        break;
     default:
         cli::error("ltd: Unrecognized command. See 'ltd help'.\n");
         print_usage();
@@ -0,0 +1,301 @@
+#include "module.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <set>
+#include <sstream>
+
+#include "../inc/ltd/cli.hpp"
+#include "../inc/ltd/fmt.hpp"
+
+#include "config.hpp"
+#include "hash.hpp"
+#include "jobs.hpp"
+#include "toolchain.hpp"
+
+namespace fs = std::filesystem;
+
+namespace ltd
+{
+    namespace sdk
+    {
+        namespace
+        {
+            string join(const string_list& items, const string& separator)
+            {
+                string result;
+                for (const auto& item : items)
+                    result += (result.length() > 0 ? separator : "") + item;
+
+                return result;
+            }
+
+            /**
+             * @brief
+             * Hash the imports and the modification times of the manifests they
+             * were resolved from, the key of the cached resolution.
+             */
+            string import_stamp(const string_list& imports, const string& compiler, const string& standard, 
+                                const string_list& manifests)
+            {
+                Hash hash;
+                hash.update(join(imports, ":"));
+                hash.update(compiler);
+                hash.update(standard);
+
+                for (const auto& manifest : manifests) {
+                    std::error_code ec;
+                    auto time = fs::last_write_time(manifest, ec);
+
+                    hash.update(manifest);
+                    hash.update(ec ? (uint64_t)0 : (uint64_t)time.time_since_epoch().count());
+                }
+
+                return hash.hex();
+            }
+
+            // The cache has one key per line followed by its tab separated values
+            bool load_cache(const string& path, std::map<string,string_list>& values)
+            {
+                std::ifstream file(path);
+                if (!file)
+                    return false;
+
+                string line;
+                while (std::getline(file, line)) {
+                    string_list items = split(line, "\t");
+                    if (items.size() == 0)
+                        continue;
+
+                    string key = items.at(0);
+                    items.erase(items.begin());
+                    values[key] = items;
+                }
+
+                return true;
+            }
+
+            void save_cache(const string& path, const std::map<string,string_list>& values)
+            {
+                std::ofstream file(path, std::ios::trunc);
+
+                for (const auto& [key, items] : values) {
+                    file << key;
+                    for (const auto& item : items)
+                        file << '\t' << item;
+                    file << '\n';
+                }
+            }
+
+            string first(const std::map<string,string_list>& values, const string& key)
+            {
+                auto found = values.find(key);
+                return found != values.end() && found->second.size() > 0 ? found->second.at(0) : "";
+            }
+
+            /**
+             * @brief
+             * Get the first line of `<compiler> --version`, from the `abi` entry
+             * of the cache when the compiler binary is unchanged.
+             */
+            string compiler_version(const string& compiler, const string& cache_path)
+            {
+                string_list binary = find_program(get_compiler_program(compiler));
+
+                std::map<string,string_list> cache;
+                bool cached = cache_path.length() > 0 && binary.size() > 0 && load_cache(cache_path, cache);
+
+                const string_list& entry = cache["abi"];
+                if (cached && entry.size() == 4 && entry[0] == compiler && entry[1] == binary[0] && entry[2] == binary[1])
+                    return entry[3];
+
+                Job job;
+                run_process(compiler + " --version", job);
+
+                string version = job.output.substr(0, job.output.find('\n'));
+
+                if (cache_path.length() > 0 && binary.size() > 0) {
+                    cache["abi"] = { compiler, binary[0], binary[1], version };
+                    save_cache(cache_path, cache);
+                }
+
+                return version;
+            }
+        }
+
+        string get_module_manifest_name()
+        {
+            return "ltd.module";
+        }
+
+        string get_abi_fingerprint(const string& compiler, const string& standard, const string& cache_path)
+        {
+            Hash hash;
+            hash.update(compiler_version(compiler, cache_path));
+            hash.update(standard);
+
+            return hash.hex();
+        }
+
+        err write_module_manifest(const string& path, const ModuleManifest& manifest)
+        {
+            string content = "# Written by ltd deploy\n";
+            content += "deps = " + join(manifest.deps, ":") + "\n";
+            content += "libs = " + join(manifest.libs, ":") + "\n";
+            content += "flags = " + manifest.flags + "\n";
+            content += "link_flags = " + manifest.link_flags + "\n";
+            content += "abi = " + manifest.abi + "\n";
+
+            std::ifstream in(path);
+            std::stringstream current;
+            current << in.rdbuf();
+
+            if (in && current.str() == content)
+                return err::no_error;
+
+            std::ofstream out(path, std::ios::trunc);
+            out << content;
+            out.close();
+
+            return out ? err::no_error : err::invalid_operation;
+        }
+
+        err read_module_manifest(const string& path, ModuleManifest& manifest)
+        {
+            ProjectConfig config;
+            err e = config.load(path);
+            if (e != err::no_error)
+                return e;
+
+            manifest.deps       = config.get_list("deps");
+            manifest.libs       = config.get_list("libs");
+            manifest.flags      = config.get("flags");
+            manifest.link_flags = config.get("link_flags");
+            manifest.abi        = config.get("abi");
+
+            return err::no_error;
+        }
+
+        err resolve_imports(const string& modules_path, const string_list& imports, const string& compiler,
+                            const string& standard, const string& cache_path, ImportSet& result)
+        {
+            result = ImportSet();
+
+            if (imports.size() == 0)
+                return err::no_error;
+
+            std::map<string,string_list> cache;
+            if (load_cache(cache_path, cache) && first(cache, "stamp") == import_stamp(imports, compiler, standard, cache["manifests"])) {
+                result.modules    = cache["modules"];
+                result.inc_paths  = cache["inc_paths"];
+                result.lib_paths  = cache["lib_paths"];
+                result.libraries  = cache["libraries"];
+                result.flags      = cache["flags"];
+                result.link_flags = cache["link_flags"];
+
+                cli::debug("Imports: %s (cached)", join(result.modules, ":"));
+                return err::no_error;
+            }
+
+            string abi = get_abi_fingerprint(compiler, standard, cache_path);
+
+            std::map<string, ModuleManifest> manifests;
+            std::set<string> visiting;
+            string_list order;
+            string_list manifest_paths;
+
+            std::function<err(const string&)> visit = [&](const string& name) -> err {
+                if (manifests.count(name) > 0)
+                    return err::no_error;
+
+                if (visiting.count(name) > 0) {
+                    cli::error("Import cycle at module '%s'", name);
+                    return err::invalid_state;
+                }
+
+                string module_path = modules_path + "/" + name;
+                if (!fs::is_directory(module_path)) {
+                    cli::error("Module '%s' is not deployed", name);
+                    return err::not_found;
+                }
+
+                string manifest_path = module_path + "/" + get_module_manifest_name();
+                manifest_paths.push_back(manifest_path);
+
+                ModuleManifest manifest;
+                if (read_module_manifest(manifest_path, manifest) != err::no_error) {
+                    // Deployed before manifests, the library named after the module is all there is
+                    if (fs::exists(module_path + "/lib" + name + ".a"))
+                        manifest.libs.push_back(name);
+
+                    manifest_paths.push_back(module_path + "/lib" + name + ".a");
+                }
+
+                if (manifest.abi.length() > 0 && manifest.abi != abi)
+                    cli::warn("Module '%s' was built with a different compiler or C++ standard", name);
+
+                visiting.insert(name);
+
+                for (const auto& dep : manifest.deps) {
+                    err e = visit(dep);
+                    if (e != err::no_error)
+                        return e;
+                }
+
+                visiting.erase(name);
+                manifests[name] = manifest;
+                order.push_back(name);
+
+                return err::no_error;
+            };
+
+            for (const auto& import : imports) {
+                err e = visit(import);
+                if (e != err::no_error)
+                    return e;
+            }
+
+            // Dependencies were collected first, static linking needs them last
+            std::reverse(order.begin(), order.end());
+
+            for (const auto& name : order) {
+                const ModuleManifest& manifest = manifests[name];
+                string module_path = modules_path + "/" + name;
+
+                result.modules.push_back(name);
+                result.inc_paths.push_back(module_path + "/inc");
+                result.lib_paths.push_back(module_path);
+                result.libraries.insert(result.libraries.end(), manifest.libs.begin(), manifest.libs.end());
+
+                if (manifest.flags.length() > 0)
+                    result.flags.push_back(manifest.flags);
+                if (manifest.link_flags.length() > 0)
+                    result.link_flags.push_back(manifest.link_flags);
+            }
+
+            cli::debug("Imports: %s", join(result.modules, ":"));
+
+            // The compiler version was cached meanwhile, every other entry is replaced
+            std::map<string,string_list> current;
+            if (load_cache(cache_path, current) && current.count("abi") > 0)
+                cache["abi"] = current["abi"];
+
+            cache["stamp"]      = { import_stamp(imports, compiler, standard, manifest_paths) };
+            cache["manifests"]  = manifest_paths;
+            cache["modules"]    = result.modules;
+            cache["inc_paths"]  = result.inc_paths;
+            cache["lib_paths"]  = result.lib_paths;
+            cache["libraries"]  = result.libraries;
+            cache["flags"]      = result.flags;
+            cache["link_flags"] = result.link_flags;
+
+            save_cache(cache_path, cache);
+
+            return err::no_error;
+        }
+    } // namespace sdk
+} // namespace ltd
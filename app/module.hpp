@@ -0,0 +1,102 @@
+#ifndef _LTD_INCLUDE_MODULE_HPP_
+#define _LTD_INCLUDE_MODULE_HPP_
+
+#include "../inc/ltd/stddef.hpp"
+#include "../inc/ltd/err.hpp"
+
+namespace ltd
+{
+    namespace sdk
+    {
+        /**
+         * @brief
+         * Description of a deployed module, `ltd.module` in the module dir.
+         *
+         * @details
+         * The file has the `key = value` format of `ltd.conf`:
+         *
+         * ```
+         * deps = net:json          # Modules the module imports itself
+         * libs = mylib1:mylib2     # Its libraries in static link order
+         * flags = -DMYLIB_SHARED   # Compile flags of the importers
+         * link_flags = -pthread    # Link flags of the importers, after the libraries
+         * abi = 4f0c...            # Fingerprint of the compiler and standard
+         * ```
+         */
+        struct ModuleManifest
+        {
+            string_list deps;
+            string_list libs;
+            string      flags;
+            string      link_flags;
+            string      abi;
+        };
+
+        /**
+         * @brief
+         * The flattened import closure of a build.
+         */
+        struct ImportSet
+        {
+            string_list modules;        // All imported modules, importers before their deps.
+            string_list inc_paths;
+            string_list lib_paths;
+            string_list libraries;      // In static link order.
+            string_list flags;
+            string_list link_flags;
+        };
+
+        /**
+         * @brief
+         * Get the file name of the manifest inside a module dir.
+         */
+        string get_module_manifest_name();
+
+        /**
+         * @brief
+         * Get the fingerprint of what objects linked together have to agree on,
+         * the compiler version and the C++ standard.
+         *
+         * @details
+         * Getting the version runs the compiler, so it is kept in the import
+         * cache file `cache_path`, if given, until the path or the modification
+         * time of the compiler binary change.
+         */
+        string get_abi_fingerprint(const string& compiler, const string& standard, const string& cache_path = "");
+
+        /**
+         * @brief
+         * Write a manifest, only when its content changed so the file keeps
+         * its modification time otherwise.
+         */
+        err write_module_manifest(const string& path, const ModuleManifest& manifest);
+
+        /**
+         * @brief
+         * Read a manifest.
+         *
+         * @returns err::not_found if the file does not exist.
+         */
+        err read_module_manifest(const string& path, ModuleManifest& manifest);
+
+        /**
+         * @brief
+         * Resolve the imports of a build and everything they import,
+         * transitively.
+         *
+         * @details
+         * Every module comes before the modules it depends on in the link order.
+         * Modules deployed before manifests existed link their own library and
+         * nothing else. The result is cached in `cache_path` and reused as long
+         * as the imports, the compiler and the manifests of the closure are
+         * unchanged, so a build only stats the manifests.
+         *
+         * @returns err::not_found if a module is not deployed.
+         * @returns err::invalid_state if the module dependencies have a cycle.
+         */
+        err resolve_imports(const string& modules_path, const string_list& imports, const string& compiler,
+                            const string& standard, const string& cache_path, ImportSet& result);
+    } // namespace sdk
+} // namespace ltd
+
+#endif // _LTD_INCLUDE_MODULE_HPP_
@@ -0,0 +1,113 @@
+#include "profile.hpp"
+
+#include "../inc/ltd/cli.hpp"
+#include "../inc/ltd/fmt.hpp"
+
+namespace ltd
+{
+    namespace sdk
+    {
+        namespace
+        {
+            bool get_builtin_profile(const string& name, BuildProfile& profile)
+            {
+                profile = BuildProfile();
+                profile.name = name;
+
+                if (name == "debug") {
+                    profile.optimize    = "-O0";
+                    profile.debug_info  = "-g";
+                    profile.debug       = true;
+                    profile.split_dwarf = true;
+                } else if (name == "release") {
+                    profile.optimize   = "-O2";
+                    profile.defines    = { "NDEBUG" };
+                } else if (name == "relwithdebinfo") {
+                    profile.optimize   = "-O2";
+                    profile.debug_info = "-g";
+                    profile.defines    = { "NDEBUG" };
+                } else if (name == "native") {
+                    profile.optimize   = "-O3";
+                    profile.arch       = "-march=native -mtune=native";
+                    profile.defines    = { "NDEBUG" };
+                } else {
+                    return false;
+                }
+
+                return true;
+            }
+
+            bool has_profile_keys(const string& prefix, const ProjectConfig& config)
+            {
+                for (auto key : { "base", "optimize", "debug_info", "arch", "defines", "flags", "debug", "lto", "split_dwarf" }) {
+                    if (config.has(prefix + key))
+                        return true;
+                }
+
+                return false;
+            }
+        }
+
+        string BuildProfile::compile_flags() const
+        {
+            string compile_flags;
+
+            for (const auto& flag : { optimize, debug_info, arch, flags }) {
+                if (flag.length() > 0)
+                    compile_flags += " " + flag;
+            }
+
+            if (is_split_dwarf())
+                compile_flags += " -gsplit-dwarf";
+
+            for (const auto& define : defines)
+                compile_flags += " -D" + define;
+
+            return compile_flags.length() > 0 ? compile_flags.substr(1) : "";
+        }
+
+        bool BuildProfile::is_split_dwarf() const
+        {
+            return split_dwarf && debug_info.length() > 0;
+        }
+
+        string get_default_profile(const ProjectConfig& config)
+        {
+            return config.get("profile", "release");
+        }
+
+        err get_build_profile(const string& name, const ProjectConfig& config, BuildProfile& profile)
+        {
+            string prefix = "profile." + name + ".";
+
+            if (!get_builtin_profile(name, profile)) {
+                if (!has_profile_keys(prefix, config)) {
+                    cli::error("Unknown build profile '%s'", name);
+                    return err::not_found;
+                }
+
+                string base = config.get(prefix + "base", "release");
+                if (!get_builtin_profile(base, profile)) {
+                    cli::error("Unknown base profile '%s' of '%s'", base, name);
+                    return err::not_found;
+                }
+
+                profile.name = name;
+            }
+
+            profile.optimize   = config.get(prefix + "optimize", profile.optimize);
+            profile.debug_info = config.get(prefix + "debug_info", profile.debug_info);
+            profile.arch       = config.get(prefix + "arch", profile.arch);
+            profile.flags      = config.get(prefix + "flags", profile.flags);
+            profile.debug      = config.get_int(prefix + "debug", profile.debug) != 0;
+            profile.lto        = config.get_int(prefix + "lto", profile.lto) != 0;
+
+            profile.split_dwarf = config.get_int(prefix + "split_dwarf", profile.split_dwarf) != 0;
+
+            if (config.has(prefix + "defines"))
+                profile.defines = config.get_list(prefix + "defines");
+
+            return err::no_error;
+        }
+    } // namespace sdk
+} // namespace ltd
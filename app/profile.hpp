@@ -0,0 +1,88 @@
+#ifndef _LTD_INCLUDE_PROFILE_HPP_
+#define _LTD_INCLUDE_PROFILE_HPP_
+
+#include "../inc/ltd/stddef.hpp"
+#include "../inc/ltd/err.hpp"
+
+#include "config.hpp"
+
+namespace ltd
+{
+    namespace sdk
+    {
+        /**
+         * @brief
+         * Phase of a profile guided optimization build.
+         */
+        enum PgoMode
+        {
+            PGO_OFF,
+            PGO_GENERATE,       // Instrument the binaries to write profile data.
+            PGO_USE             // Optimize with the profile data.
+        };
+
+        /**
+         * @brief
+         * A named set of code generation flags. Every profile is built into 
+         * its own directory, `<builds>/<project>/<profile>`.
+         */
+        struct BuildProfile
+        {
+            string      name;
+            string      optimize;       // Optimization level, i.e. '-O2'.
+            string      debug_info;     // Debug info flags, i.e. '-g'.
+            string      arch;           // Target CPU flags, i.e. '-march=native'.
+            string_list defines;        // Preprocessor defines, i.e. 'NDEBUG'.
+            string      flags;          // Any other compile flags.
+            bool        debug = false;  // Whether this is a debugging build.
+            bool        lto = false;    // Optimize at link time.
+            bool        split_dwarf = false; // Keep the debug info out of the objects.
+
+            /**
+             * @brief
+             * Get the compile flags of the profile.
+             */
+            string compile_flags() const;
+
+            /**
+             * @brief
+             * Check whether the debug info goes into .dwo files next to the
+             * objects, which the linker does not need to copy.
+             */
+            bool is_split_dwarf() const;
+        };
+
+        /**
+         * @brief
+         * Get the default profile of a project, `profile` in `ltd.conf` or
+         * release.
+         */
+        string get_default_profile(const ProjectConfig& config);
+
+        /**
+         * @brief
+         * Get a build profile by name.
+         *
+         * @details
+         * The built in profiles are `debug`, `release`, `relwithdebinfo` and 
+         * `native`. A project can change them and define its own profiles in
+         * `ltd.conf`, a new profile starts from `release` unless `base` says 
+         * otherwise:
+         *
+         * ```
+         * profile = native
+         * profile.native.arch = -march=x86-64-v3
+         * profile.fast.base = native
+         * profile.fast.optimize = -Ofast
+         * profile.fast.defines = NDEBUG:FAST_MATH=1
+         * profile.fast.lto = 1
+         * profile.debug.split_dwarf = 0
+         * ```
+         *
+         * @returns err::not_found if the profile does not exist.
+         */
+        err get_build_profile(const string& name, const ProjectConfig& config, BuildProfile& profile);
+    } // namespace sdk
+} // namespace ltd
+
+#endif // _LTD_INCLUDE_PROFILE_HPP_
@@ -7,11 +7,20 @@
 #include <string>
 #include <fstream>
 #include <algorithm>
+#include <map>
+#include <memory>
 
 #include "../inc/ltd/cli.hpp"
 
 #include "sdk.hpp"
 #include "compiler.hpp"
+#include "deploy.hpp"
+#include "module.hpp"
+#include "targets.hpp"
+#include "profile.hpp"
+#include "toolchain.hpp"
+#include "trace.hpp"
+#include "worker.hpp"
 
 namespace ltd
 {
@@ -34,20 +43,24 @@ namespace ltd
             return env_home;
         }
 
+        // The active project is read once per ltd run
+        static bool active_project_read = false;
+        static string active_project;
+
         string get_active_project()
         {
-            string file_name = get_homepath() + "/.project";
+            if (active_project_read)
+                return active_project;
 
-            if(fs::exists(file_name)) {
-                std::ifstream file(file_name);
-                string project;
+            string file_name = get_homepath() + "/.project";
+            std::ifstream file(file_name);
 
-                file >> project;
+            if(file) 
+                file >> active_project;
 
-                return project; 
-            }
+            active_project_read = true;
 
-            return "";
+            return active_project;
         }
 
         void set_active_project(const string& project)
@@ -59,6 +72,9 @@ namespace ltd
             file << project << std::endl;
 
             file.close();
+
+            active_project = project;
+            active_project_read = true;
         }
 
         string get_active_project_path()
@@ -66,7 +82,7 @@ namespace ltd
             return get_homepath() + "/projects/" + get_active_project();
         }
 
-        void deploy_to_module_path()
+        err deploy_to_module_path(const string& profile)
         {
             string project_path = get_active_project_path();
             string module_path = get_homepath() + "/modules/" + get_active_project();
@@ -74,20 +90,80 @@ namespace ltd
             if(!fs::exists(get_homepath() + "/modules/"))
                 fs::create_directory(get_homepath() + "/modules/");
 
-            if(!fs::exists(module_path))
-                fs::create_directory(module_path);
+            string build_path = get_active_build_path(profile) + "/target";
+
+            ProjectConfig config;
+            get_project_config(config);
+
+            TargetGraph graph;
+            err e = graph.load(get_active_project(), project_path, config);
+            if (e != err::no_error)
+                return e;
+
+            // Libraries depend on the ones before them, static linking needs them last
+            ModuleManifest manifest;
+            for (const auto& target : graph.get_targets()) {
+                if (target.kind == TARGET_LIB && fs::exists(build_path + "/lib" + target.name + ".a"))
+                    manifest.libs.insert(manifest.libs.begin(), target.name);
+            }
+
+            string compiler = get_project_compiler(config);
+
+            manifest.deps       = config.get_list("imports");
+            manifest.flags      = config.get("module.flags");
+            manifest.link_flags = config.get("module.link_flags");
+            manifest.abi        = get_abi_fingerprint(compiler, config.get("std", Cpp().get_standard()),
+                                                  get_active_build_path(profile) + "/.ltd_imports");
+
+            string manifest_dir = get_homepath() + "/builds/" + get_active_project() + "/module";
+            fs::create_directories(manifest_dir);
+
+            e = write_module_manifest(manifest_dir + "/" + get_module_manifest_name(), manifest);
+            if (e != err::no_error) {
+                cli::error("Unable to write the module manifest: %s", manifest_dir);
+                return e;
+            }
+
+            // A thin archive only refers to the objects of the build, the module gets a normal one
+            string archiver = get_archiver(compiler, true);
+            string_list thin_archives;
+
+            for (const auto& lib : manifest.libs) {
+                string name = "lib" + lib + ".a";
+                string archive = build_path + "/" + name;
+                string flattened = manifest_dir + "/" + name;
 
-            if(!fs::exists(module_path + "/inc") )
-                fs::create_directory(module_path + "/inc");
+                std::error_code ec;
+                if (!is_thin_archive(archive)) {
+                    fs::remove(flattened, ec);
+                    continue;
+                }
+
+                thin_archives.push_back(name);
+
+                if (fs::exists(flattened, ec) && fs::last_write_time(flattened, ec) == fs::last_write_time(archive, ec))
+                    continue;
+
+                e = flatten_archive(archiver, archive, flattened);
+                if (e != err::no_error)
+                    return e;
+            }
+
+            std::vector<DeploySource> sources;
+            if (fs::exists(project_path + "/inc"))
+                sources.push_back({project_path + "/inc", "inc", {}});
+            sources.push_back({build_path, "", thin_archives});
+            sources.push_back({manifest_dir, "", {}});
 
-            fs::copy(project_path + "/inc", module_path + "/inc", 
-                        fs::copy_options::recursive | 
-                        fs::copy_options::overwrite_existing);
+            DeployStats stats;
+            e = deploy_module(sources, module_path, stats);
+            if (e != err::no_error)
+                return e;
 
-            string build_path = get_homepath() + "/builds/" + get_active_project() + "/release/target/";
+            cli::info("Deployed %s: %d unchanged, %d cloned, %d copied, %d removed", 
+                      get_active_project(), stats.linked, stats.cloned, stats.copied, stats.removed);
 
-            fs::copy(build_path, module_path , fs::copy_options::recursive | 
-                                               fs::copy_options::overwrite_existing);
+            return err::no_error;
         }
 
         string get_builds_path()
@@ -95,10 +171,25 @@ namespace ltd
             return get_homepath() + "/builds";
         }
 
-        string get_active_build_path(bool debug)
+        string get_cache_path()
+        {
+            return get_homepath() + "/cache";
+        }
+
+        string get_active_build_path(const string& profile)
+        {
+            return  get_builds_path() + "/" + get_active_project() + "/" + profile; 
+        }
+
+        string get_active_profile(const string& requested)
         {
-            string build_mode = debug ? "/debug" : "/release";
-            return  get_builds_path() + "/" + get_active_project() + build_mode; 
+            if (requested.length() > 0)
+                return requested;
+
+            ProjectConfig config;
+            get_project_config(config);
+
+            return get_default_profile(config);
         }
 
         void get_projects_list(string_list& projects)
@@ -163,94 +254,410 @@ namespace ltd
                 }
             } 
 
-            struct
-            {
-                bool operator()(const string& a, const string& b) const { return a < b; }
+            std::sort(dirs.begin(), dirs.end());
+        }
+
+        void get_project_config(ProjectConfig& config)
+        {
+            config.load(get_active_project_path() + "/ltd.conf");
+        }
+
+        string get_project_pch(const ProjectConfig& config)
+        {
+            string project_path = get_active_project_path();
+
+            if (config.has("pch")) {
+                string pch = config.get("pch");
+                return pch.length() > 0 ? project_path + "/" + pch : "";
             }
-            customLess;
-
-            // Sort dirs to prioritize library builds first
-            std::sort(dirs.begin(), dirs.end(), [] (const string& a, const string& b) 
-                                                        {
-                                                            if (a.find("lib") == 0)
-                                                                return true;
-                                                            return false;
-                                                        });
+
+            string pch = project_path + "/pch.hpp";
+            return fs::exists(pch) ? pch : "";
         }
 
-        void build_dir(const string& name, const string& sub_dir, bool debug, string_list& imports)
+        string get_project_compiler(const ProjectConfig& config)
         {
-            string build_mode = debug ? "/debug" : "/release";
+            return config.get("compiler", get_default_compiler());
+        }
+
+        err build_project(const BuildOptions& options)
+        {
+            BuildState state;
+            return build_project(options, state);
+        }
 
-            cli::info("Building: %s", sub_dir);
-            cli::info("Build mode: %s", debug ? "DEBUG" : "RELEASE");
+        err build_project(const BuildOptions& options, BuildState& state)
+        {
+            string project = get_active_project();
+            string project_path = get_active_project_path();
 
-            // Get source file path
-            string src_path = sdk::get_active_project_path() + sub_dir;
-            cli::debug("Source path: %s", src_path);
+            ProjectConfig config;
+            get_project_config(config);
 
-            // Determine object file path
-            string dst_path = sdk::get_builds_path();
-            if (fs::exists(dst_path) == false) {
-                fs::create_directory(dst_path);
-            }
-            cli::debug("Build path: %s", dst_path);
-            
-            dst_path += "/" + sdk::get_active_project();
-            if (fs::exists(dst_path) == false) {
-                fs::create_directory(dst_path);
-            }
+            TargetGraph graph;
+            err e = graph.load(project, project_path, config);
+            if (e != err::no_error)
+                return e;
 
-            string build_dir = dst_path + build_mode; 
+            BuildProfile profile;
+            e = get_build_profile(options.profile, config, profile);
+            if (e != err::no_error)
+                return e;
+
+            cli::info("Build profile: %s", profile.name);
+            cli::debug("Profile flags: %s", profile.compile_flags());
+
+            string build_dir = get_active_build_path(profile.name);
+
+            PgoMode pgo = options.pgo;
+            string pgo_data = get_pgo_data_path(profile.name);
+
+            if (pgo == PGO_GENERATE)
+                build_dir = get_active_build_path(profile.name + "-pgo");
+            else if (pgo == PGO_OFF && !profile.debug && fs::exists(pgo_data + "/.trained"))
+                pgo = PGO_USE;
+
+            if (pgo == PGO_USE)
+                cli::info("Using profile data: %s", pgo_data);
+            string target_dir = build_dir + "/target/";
             cli::debug("Build path: %s", build_dir);
-            if (fs::exists(build_dir) == false) {
-                fs::create_directory(build_dir);
+
+            fs::create_directories(target_dir);
+
+            // The log, and the file times it caches, is kept between builds of a session
+            string log_path = build_dir + "/.ltd_log";
+            if (!state.log || state.log->get_path() != log_path) {
+                state.log = std::make_shared<BuildLog>(log_path);
+                state.log->load();
+            }
+
+            auto log = state.log;
+
+            // Objects also depend on the profile data, which the cache key misses
+            std::shared_ptr<ObjectCache> cache;
+            if (options.use_cache && pgo == PGO_OFF)
+                cache = std::make_shared<ObjectCache>(get_cache_path());
+
+            string pch = get_project_pch(config);
+            if (pch.length() > 0)
+                cli::debug("Prefix header: %s", pch);
+
+            string compiler = get_project_compiler(config);
+            cli::debug("Compiler: %s", compiler);
+
+            // Remote slots come on top of the local jobs, for compilations only
+            LocalWorkers local_workers;
+            if (options.local_workers > 0) {
+                e = local_workers.start(options.local_workers);
+                if (e != err::no_error)
+                    return e;
             }
 
-            string obj_path = build_dir + sub_dir;
-            cli::debug("Build object path: %s", obj_path);
-            if (fs::exists(obj_path) == false) {
-                fs::create_directory(obj_path);
+            string_list worker_addresses = options.workers;
+            worker_addresses.insert(worker_addresses.end(), local_workers.get_addresses().begin(), 
+                                    local_workers.get_addresses().end());
+
+            std::shared_ptr<CompileWorkers> workers;
+            int jobs = options.jobs;
+            int remote_slots = 0;
+
+            if (worker_addresses.size() > 0) {
+                workers = std::make_shared<CompileWorkers>(compiler, worker_addresses);
+
+                int slots = workers->probe();
+                cli::info("Compile workers: %d slots", slots);
+
+                if (slots > 0)
+                    remote_slots = slots;
+                else
+                    workers.reset();
             }
 
-            if(!fs::exists(build_dir + "/target/")) {
-                fs::create_directories(build_dir + "/target/");
+            // The probes of the linker and its flags are kept with the build
+            load_link_probes(build_dir + "/.ltd_probes");
+
+            // LTO objects need a linker that understands them
+            string linker_name = options.linker.length() > 0 ? options.linker : config.get("linker", "auto");
+            string linker = find_linker(compiler, linker_name, options.lto || profile.lto ? "-flto=auto" : "");
+            cli::debug("Linker: %s", linker.length() > 0 ? linker : "default");
+
+            // Imports of the command line come first, then the project's own
+            string_list import_names = options.imports;
+            for (const auto& import : config.get_list("imports")) {
+                if (std::find(import_names.begin(), import_names.end(), import) == import_names.end())
+                    import_names.push_back(import);
             }
 
-            Cpp cc;
+            string standard = options.standard.length() > 0 ? options.standard : config.get("std", Cpp().get_standard());
+
+            ImportSet imports;
+            e = resolve_imports(get_homepath() + "/modules", import_names, compiler, standard,
+                                build_dir + "/.ltd_imports", imports);
+            if (e != err::no_error)
+                return e;
+
+            // One source declaring or importing a module builds the project with modules
+            std::shared_ptr<ModuleGraph> modules;
+            if (supports_modules(standard)) {
+                string toolchain = get_abi_fingerprint(compiler, standard, build_dir + "/.ltd_imports").substr(0, 16);
+                auto module_graph = std::make_shared<ModuleGraph>(build_dir + "/bmi", get_cache_path() + "/bmi/" + toolchain);
+
+                bool found = false;
+                for (const auto& target : graph.get_targets()) {
+                    string_list sources;
+                    log->list_sources(project_path + target.sub_dir, sources);
+
+                    if (module_graph->scan(sources))
+                        found = true;
+                }
+
+                if (found) {
+                    modules = module_graph;
+                    fs::create_directories(modules->get_bmi_dir());
+
+                    cli::debug("Module BMIs: %s", modules->get_bmi_dir());
 
-            // Add include imports
-            for (auto import : imports) {
-                cc.add_inc_path(get_homepath() + "/modules/" + import + "/inc");
-                cc.add_lib_path(get_homepath() + "/modules/" + import);
-                cc.add_library(import);
+                    // Imported headers replace the prefix header
+                    if (pch.length() > 0)
+                        cli::debug("Prefix header ignored with modules: %s", pch);
+                    pch = "";
+                }
             }
 
-            int files_compiled = cc.compile_files(src_path, obj_path);
+            // The jobs refer to their Cpp, which needs a stable address
+            std::vector<std::unique_ptr<Cpp>> compilers;
+            std::map<string, JobIds> lib_jobs;
+            std::map<string, JobIds> app_jobs;
+            std::map<string, string> app_dirs;
+            std::map<string, JobIds> pch_jobs;
+            Jobs queue;
+
+            bool has_tests = std::any_of(graph.get_targets().begin(), graph.get_targets().end(), [](const Target& target) {
+                return target.kind == TARGET_TESTS || target.kind == TARGET_BENCH;
+            });
+
+            for (const auto& target : graph.get_targets()) {
+                cli::info("Building: %s", target.sub_dir);
+
+                string src_path = project_path + target.sub_dir;
+                string obj_path = build_dir + target.sub_dir;
+                cli::debug("Source path: %s", src_path);
+                cli::debug("Build object path: %s", obj_path);
+
+                fs::create_directories(obj_path);
+
+                compilers.push_back(std::make_unique<Cpp>());
+                Cpp& cc = *compilers.back();
+
+                cc.set_compiler(compiler);
+                cc.set_profile(profile);
+                cc.set_thin_archives(options.thin_archives);
+                cc.set_lto(options.lto || profile.lto);
+                cc.set_pgo(pgo, pgo_data, build_dir);
+                cc.set_linker(linker);
+                cc.set_time_trace(options.trace.length() > 0);
+                cc.set_log(log);
+                cc.set_cache(cache);
+                cc.set_workers(workers);
+
+                cc.set_standard(standard);
+                cc.set_modules(modules);
+
+                // Every test and benchmark source is an executable of its own
+                if (target.kind != TARGET_TESTS && target.kind != TARGET_BENCH)
+                    cc.set_unity_size(options.unity);
+
+                // Tests and benchmarks link with the objects of the applications, which
+                // come before them in the target order. The linker only pulls the objects
+                // they use out of the archive, never the one with main.
+                JobIds after;
+                if (target.kind == TARGET_TESTS || target.kind == TARGET_BENCH) {
+                    for (const auto& [name, jobs] : app_jobs) {
+                        cc.add_lib_path(app_dirs[name]);
+                        cc.add_library(name + "_app");
+                        after.insert(after.end(), jobs.begin(), jobs.end());
+                    }
+                }
+
+                // Project libraries come first in link order, imports last
+                string_list libs = graph.link_order(target);
+
+                if (target.kind != TARGET_LIB && libs.size() > 0)
+                    cc.add_lib_path(target_dir);
+
+                for (const auto& lib : libs) {
+                    cc.add_library(lib);
+                    after.insert(after.end(), lib_jobs[lib].begin(), lib_jobs[lib].end());
+                }
 
-            if (sub_dir.find("/lib")==0) {
-                if (files_compiled == 0) {
-                    cli::info("Binary is up-to-date...");
-                    return;
+                for (const auto& inc_path : imports.inc_paths)
+                    cc.add_inc_path(inc_path);
+                for (const auto& lib_path : imports.lib_paths)
+                    cc.add_lib_path(lib_path);
+                for (const auto& library : imports.libraries)
+                    cc.add_library(library);
+                for (const auto& flag : imports.flags)
+                    cc.add_flag(flag);
+                for (const auto& flag : imports.link_flags)
+                    cc.add_link_flag(flag);
+
+                // Targets with the same flags share one precompiled header
+                if (pch.length() > 0) {
+                    string stub = build_dir + "/pch/" + cc.get_pch_key() + "/" + fs::path(pch).filename().string();
+
+                    if (pch_jobs.count(stub) == 0)
+                        pch_jobs[stub] = cc.build_pch(pch, stub, queue);
+
+                    cc.set_pch(stub, pch_jobs[stub]);
                 }
 
-                string target = build_dir + "/target/lib" + name + ".a";
-                cc.build_lib(obj_path, target);
-            } else if (sub_dir.find("/app")==0) {
-                if (files_compiled == 0) {
-                    cli::info("Binary is up-to-date...");
-                    return;
+                string_list objects;
+                JobIds compiled = cc.compile_files(src_path, obj_path, objects, queue);
+                after.insert(after.end(), compiled.begin(), compiled.end());
+
+                if (target.kind == TARGET_LIB) {
+                    string lib_target = target_dir + "lib" + target.name + ".a";
+                    lib_jobs[target.name] = cc.build_lib(objects, lib_target, compiled, queue);
+                } else if (target.kind == TARGET_APP) {
+                    cc.build_app(objects, target_dir + target.name, after, queue);
+
+                    if (has_tests) {
+                        app_jobs[target.name] = cc.build_lib(objects, obj_path + "/lib" + target.name + "_app.a", compiled, queue);
+                        app_dirs[target.name] = obj_path;
+                    }
+                } else if (target.kind == TARGET_BENCH) {
+                    cc.build_tests(objects, build_dir + "/bench/", after, queue);
+                } else {
+                    cc.build_tests(objects, build_dir + "/tests/", after, queue);
                 }
-                
-                string target = build_dir + "/target/" + name;
-                cc.add_lib_path(build_dir + "/target/");
-                cc.add_library(name);
-                cc.build_app(obj_path, target);
+            }
+
+            BuildTrace trace(options.trace);
+
+            // The last build tells how long and how much memory each job takes
+            string history_path = build_dir + "/.ltd_jobs";
+            load_job_history(history_path, queue);
+
+            long budget = options.memory > 0 ? options.memory * 1024 : get_available_memory();
+            cli::debug("Memory budget: %d MB", budget / 1024);
+
+            // Share the job slots of a parent make, or offer ours to the make and gcc LTO runs of the build
+            auto job_server = std::make_shared<JobServer>();
+            const char* makeflags = getenv("MAKEFLAGS");
+
+            e = job_server->attach(makeflags != NULL ? makeflags : "");
+            if (e == err::no_error) {
+                cli::info("Using the jobserver of make");
+            } else if (e == err::invalid_state) {
+                // What make does without its jobserver
+                jobs = 1;
+                job_server.reset();
+            } else if (job_server->serve(jobs) != err::no_error) {
+                job_server.reset();
+            }
+
+            JobPool pool(jobs);
+            pool.set_remote_slots(remote_slots);
+            pool.set_memory_budget(budget);
+            pool.set_max_links(std::max(1, jobs / 4));
+            pool.set_job_server(job_server);
+
+            e = pool.run(queue);
+            save_job_history(history_path, queue);
+            save_link_probes();
+
+            if (options.trace.length() > 0) {
+                trace.add_jobs(queue);
+                trace.save();
+            }
+
+            if (cache && cache->get_hits() + cache->get_misses() > 0)
+                cli::debug("Cache hits: %d, misses: %d", cache->get_hits(), cache->get_misses());
+
+            // Misses store new entries, the least recently used ones make room for them
+            if (cache && cache->get_misses() > 0 && options.cache_size > 0) {
+                int removed = cache->trim((uintmax_t)options.cache_size * 1024 * 1024);
+                if (removed > 0)
+                    cli::debug("Cache trimmed: %d entries removed", removed);
+            }
+
+            // Successful jobs are kept even when the build failed
+            log->save();
+
+            state.built.clear();
+            for (const auto& job : queue) {
+                if (job.slot >= 0 && job.exit_code == 0 && job.target.length() > 0)
+                    state.built.push_back(job.target);
+            }
+
+            return e;
+        }
+
+        string get_pgo_data_path(const string& profile)
+        {
+            return get_builds_path() + "/" + get_active_project() + "/pgo-data/" + profile;
+        }
+
+        err pgo_build_project(BuildOptions options, const string& train, const string& train_args)
+        {
+            ProjectConfig config;
+            get_project_config(config);
+
+            BuildProfile profile;
+            err e = get_build_profile(options.profile, config, profile);
+            if (e != err::no_error)
+                return e;
+
+            // Counters of an older training would be merged into the new ones
+            string pgo_data = get_pgo_data_path(profile.name);
+            fs::remove_all(pgo_data);
+            fs::create_directories(pgo_data);
+
+            cli::info("PGO: building instrumented binaries");
+
+            options.pgo = PGO_GENERATE;
+            e = build_project(options);
+            if (e != err::no_error)
+                return e;
+
+            string gen_path = get_active_build_path(profile.name + "-pgo");
+
+            string_list commands;
+            if (train.length() > 0) {
+                commands.push_back(fmt::sprintf("%s/target/%s %s", gen_path, train, train_args));
             } else {
-                cc.add_lib_path(build_dir + "/target/");
-                cc.add_library(name);
-                cc.build_tests(obj_path, build_dir + "/tests/");
+                std::error_code ec;
+                for (const auto& dir_entry : fs::directory_iterator(gen_path + "/tests", ec)) {
+                    auto ext = dir_entry.path().extension();
+
+                    if (!dir_entry.is_directory() && ext != ".o" && ext != ".d")
+                        commands.push_back(dir_entry.path().string() + " -a");
+                }
+
+                std::sort(commands.begin(), commands.end());
+            }
+
+            if (commands.size() == 0) {
+                cli::error("PGO: nothing to train with, set --run or add unit tests");
+                return err::not_found;
+            }
+
+            for (const auto& command : commands) {
+                cli::info("PGO: training with %s", command);
+
+                int result = std::system(command.c_str());
+                if (result != 0)
+                    cli::warn("PGO: training run exited with %d", result);
             }
+
+            std::ofstream stamp(pgo_data + "/.trained", std::ios::trunc);
+            stamp << train << " " << train_args << std::endl;
+            stamp.close();
+
+            cli::info("PGO: building optimized binaries");
+
+            options.pgo = PGO_USE;
+            return build_project(options);
         }
 
         fs::file_time_type get_dir_write_time(const string& path)
@@ -289,11 +696,19 @@ namespace ltd
             }
         }
 
-        void clean_project(bool debug)
+        void clean_project(const string& profile)
         {
-            string path = get_active_build_path(debug);
-            fs::path dir_path(path);
-            clear_dir(dir_path);
+            string path = get_active_build_path(profile);
+
+            // The job history schedules the next clean build
+            for (const auto& dir_entry : fs::directory_iterator(path)) {
+                if (dir_entry.path().filename() == ".ltd_jobs")
+                    continue;
+
+                if (dir_entry.is_directory())
+                    clear_dir(dir_entry);
+                fs::remove(dir_entry);
+            }
         }
     }
 }
\ No newline at end of file
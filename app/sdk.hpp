@@ -2,7 +2,14 @@
 #define _LTD_INCLUDE_SDK_HPP_
 
 #include <filesystem>
+#include <memory>
+
 #include "../inc/ltd/stddef.hpp"
+#include "../inc/ltd/err.hpp"
+
+#include "config.hpp"
+#include "profile.hpp"
+#include "buildlog.hpp"
 
 namespace fs = std::filesystem;
 
@@ -19,9 +26,52 @@ namespace ltd
             CMD_BUILD,
             CMD_CLEAN,
             CMD_TEST,
+            CMD_BENCH,
             CMD_DEPLOY,
             CMD_HELP, 
-            CMD_GET
+            CMD_GET,
+            CMD_WATCH,
+            CMD_WORKER,
+            CMD_CACHE
+        };
+
+        /**
+         * @brief
+         * Unity batch size used by a bare `--unity`.
+         */
+        const int DEFAULT_UNITY_SIZE = 8;
+
+        /**
+         * @brief
+         * Options of a build, collected from the command line.
+         */
+        struct BuildOptions
+        {
+            string profile = "release"; // Name of the build profile.
+            int  jobs = 1;              // Maximum number of parallel jobs.
+            bool use_cache = true;      // Use the object cache under $LTD_HOME/cache.
+            int  unity = 0;             // Unity batch size, 0 compiles every source on its own.
+            bool thin_archives = false; // Create thin archives referring to the objects.
+            bool lto = false;           // Optimize at link time, on top of the profile.
+            PgoMode pgo = PGO_OFF;      // Profile guided optimization phase, see build_project.
+            string linker;              // Linker name or 'auto', the project default when empty.
+            string trace;               // Chrome trace file of the build, none when empty.
+            string standard;            // C++ standard, compiler default of ltd when empty.
+            string_list imports;        // Modules to link with the project.
+            string_list workers;        // Addresses of compile workers, see CompileWorkers.
+            int  local_workers = 0;     // Compile workers spawned for the build only.
+            long memory = 0;            // Memory budget of the jobs in MB, the available memory when 0.
+            long cache_size = 0;        // Size limit of the object cache in MB, 0 for no limit.
+        };
+
+        /**
+         * @brief
+         * State kept between the builds of one ltd run, i.e. by `ltd watch`.
+         */
+        struct BuildState
+        {
+            std::shared_ptr<BuildLog> log;  // Build log of the last build dir, loaded once.
+            string_list built;              // Outputs built by the last build.
         };
 
         /**
@@ -62,15 +112,23 @@ namespace ltd
 
         /**
          * @brief
-         * Get the active build absolute path.
+         * Get the active build absolute path of a build profile.
+         */
+        string get_active_build_path(const string& profile);
+
+        /**
+         * @brief
+         * Get the build profile to use, the requested one or the default of
+         * the active project when empty.
          */
-        string get_active_build_path(bool debug);
+        string get_active_profile(const string& requested);
 
         /**
          * @brief
-         * Copy the project files into importable modules path.
+         * Update the importable module of the active project with its headers
+         * and the binaries of a build profile. Only changed files are copied.
          */
-        void deploy_to_module_path();
+        err deploy_to_module_path(const string& profile);
 
         /**
          * @brief
@@ -92,9 +150,68 @@ namespace ltd
 
         /**
          * @brief
-         * Build a source dir into a target binary, executable or static library.
+         * Build all targets of the active project. Compile jobs of all targets
+         * run concurrently, and each archive or link job starts as soon as the 
+         * objects and libraries it needs are ready. A non debug profile uses 
+         * the profile guided optimization data recorded for it, if any.
+         */
+        err build_project(const BuildOptions& options);
+
+        /**
+         * @brief
+         * Build all targets of the active project, keeping the build log in 
+         * memory between calls. Files changed since the previous build have to
+         * be invalidated in the log.
+         */
+        err build_project(const BuildOptions& options, BuildState& state);
+
+        /**
+         * @brief
+         * Build the active project with profile guided optimization. 
+         *
+         * @details
+         * The project is built with instrumentation into `<profile>-pgo`, then
+         * `train` is run from its target dir with `train_args`, or every unit
+         * test when `train` is empty. Finally the profile is rebuilt using the
+         * recorded data.
+         */
+        err pgo_build_project(BuildOptions options, const string& train, const string& train_args);
+
+        /**
+         * @brief
+         * Get the directory of the profile guided optimization data of a build
+         * profile of the active project. Later builds of the profile keep using
+         * the data until the directory is removed.
+         */
+        string get_pgo_data_path(const string& profile);
+
+        /**
+         * @brief
+         * Read the `ltd.conf` of the active project.
+         */
+        void get_project_config(ProjectConfig& config);
+
+        /**
+         * @brief
+         * Get the prefix header of the active project, set by `pch` in `ltd.conf`
+         * or `pch.hpp` in the project root. An empty `pch` value disables it.
+         *
+         * @returns The absolute path, empty when the project has none.
+         */
+        string get_project_pch(const ProjectConfig& config);
+
+        /**
+         * @brief
+         * Get the compiler of the active project, set by `compiler` in `ltd.conf`,
+         * otherwise the default compiler.
+         */
+        string get_project_compiler(const ProjectConfig& config);
+
+        /**
+         * @brief
+         * Get the object cache directory under home path.
          */
-        void build_dir(const string& name, const string& sub_dir, bool debug, string_list& imports);
+        string get_cache_path();
 
         /**
          * @brief
@@ -112,7 +229,7 @@ namespace ltd
          * @brief
          * Clean all binaries from the build directory.
          */
-        void clean_project(bool debug);
+        void clean_project(const string& profile);
     }
 }
 
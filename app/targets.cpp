@@ -0,0 +1,175 @@
+#include "targets.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+#include <set>
+
+#include "../inc/ltd/cli.hpp"
+
+namespace fs = std::filesystem;
+
+namespace ltd
+{
+    namespace sdk
+    {
+        namespace
+        {
+            string_list list_subdirs(const string& path)
+            {
+                string_list dirs;
+
+                std::error_code ec;
+                for(const auto& dir_entry : fs::directory_iterator(path, ec)) {
+                    if (!dir_entry.is_directory())
+                        continue;
+
+                    string name = dir_entry.path().filename();
+                    if (name.at(0) != '.')
+                        dirs.push_back(name);
+                }
+
+                std::sort(dirs.begin(), dirs.end());
+
+                return dirs;
+            }
+        }
+
+        err TargetGraph::load(const string& project, const string& project_path, const ProjectConfig& config)
+        {
+            std::vector<Target> libs;
+            std::vector<Target> others;
+
+            for (const auto& dir : list_subdirs(project_path)) {
+                if (dir == "lib") {
+                    libs.push_back({project, TARGET_LIB, "/lib", {}});
+                } else if (dir == "app") {
+                    others.push_back({project, TARGET_APP, "/app", {}});
+                } else if (dir == "tests") {
+                    others.push_back({"tests", TARGET_TESTS, "/tests", {}});
+                } else if (dir == "bench") {
+                    others.push_back({"bench", TARGET_BENCH, "/bench", {}});
+                } else if (dir == "libs") {
+                    for (const auto& name : list_subdirs(project_path + "/libs"))
+                        libs.push_back({name, TARGET_LIB, "/libs/" + name, {}});
+                } else if (dir == "apps") {
+                    for (const auto& name : list_subdirs(project_path + "/apps"))
+                        others.push_back({name, TARGET_APP, "/apps/" + name, {}});
+                }
+            }
+
+            string_list lib_names;
+            for (const auto& lib : libs)
+                lib_names.push_back(lib.name);
+
+            for (auto& lib : libs)
+                lib.deps = config.get_list(lib.name + ".deps");
+
+            for (auto& target : others) {
+                string key = target.name + ".deps";
+                target.deps = config.has(key) ? config.get_list(key) : lib_names;
+            }
+
+            // Order libraries after their dependencies, detecting cycles
+            targets.clear();
+
+            std::set<string> done;
+            std::set<string> visiting;
+
+            std::function<err(const Target&)> visit = [&](const Target& lib) -> err {
+                if (done.count(lib.name) > 0)
+                    return err::no_error;
+
+                if (visiting.count(lib.name) > 0) {
+                    cli::error("Dependency cycle at library '%s'", lib.name);
+                    return err::invalid_state;
+                }
+
+                visiting.insert(lib.name);
+
+                for (const auto& dep : lib.deps) {
+                    auto found = std::find_if(libs.begin(), libs.end(),
+                                              [&dep](const Target& t) { return t.name == dep; });
+                    if (found == libs.end()) {
+                        cli::error("Library '%s' needed by '%s' does not exist", dep, lib.name);
+                        return err::not_found;
+                    }
+
+                    err e = visit(*found);
+                    if (e != err::no_error)
+                        return e;
+                }
+
+                visiting.erase(lib.name);
+                done.insert(lib.name);
+                targets.push_back(lib);
+
+                return err::no_error;
+            };
+
+            for (const auto& lib : libs) {
+                err e = visit(lib);
+                if (e != err::no_error)
+                    return e;
+            }
+
+            for (const auto& target : others) {
+                for (const auto& dep : target.deps) {
+                    if (find_lib(dep) == nullptr) {
+                        cli::error("Library '%s' needed by '%s' does not exist", dep, target.name);
+                        return err::not_found;
+                    }
+                }
+
+                targets.push_back(target);
+            }
+
+            return err::no_error;
+        }
+
+        const std::vector<Target>& TargetGraph::get_targets() const
+        {
+            return targets;
+        }
+
+        string_list TargetGraph::link_order(const Target& target) const
+        {
+            string_list order;
+            std::set<string> visited;
+
+            std::function<void(const string&)> visit = [&](const string& name) {
+                if (visited.count(name) > 0)
+                    return;
+
+                visited.insert(name);
+
+                const Target* lib = find_lib(name);
+                if (lib == nullptr)
+                    return;
+
+                for (const auto& dep : lib->deps)
+                    visit(dep);
+
+                order.push_back(name);
+            };
+
+            for (const auto& dep : target.deps)
+                visit(dep);
+
+            // Dependencies were collected first, static linking needs them last
+            std::reverse(order.begin(), order.end());
+
+            return order;
+        }
+
+        const Target* TargetGraph::find_lib(const string& name) const
+        {
+            for (const auto& target : targets) {
+                if (target.kind == TARGET_LIB && target.name == name)
+                    return &target;
+            }
+
+            return nullptr;
+        }
+    } // namespace sdk
+} // namespace ltd
@@ -0,0 +1,84 @@
+#ifndef _LTD_INCLUDE_TARGETS_HPP_
+#define _LTD_INCLUDE_TARGETS_HPP_
+
+#include <vector>
+
+#include "../inc/ltd/stddef.hpp"
+#include "../inc/ltd/err.hpp"
+
+#include "config.hpp"
+
+namespace ltd
+{
+    namespace sdk
+    {
+        enum TargetKind
+        {
+            TARGET_LIB,
+            TARGET_APP,
+            TARGET_TESTS,
+            TARGET_BENCH
+        };
+
+        /**
+         * @brief
+         * A buildable node of a project: a static library, an application or
+         * the unit tests.
+         */
+        struct Target
+        {
+            string      name;       // Binary name, i.e. 'mylib1' for 'libs/mylib1'.
+            TargetKind  kind;
+            string      sub_dir;    // Source dir relative to the project, i.e. '/libs/mylib1'.
+            string_list deps;       // Names of the library targets linked directly.
+        };
+
+        /**
+         * @brief
+         * The targets of the active project and the dependency edges between them.
+         *
+         * @details
+         * A project either has a single `lib` and `app`, both named after the
+         * project, or several libraries and applications under `libs/<name>` and
+         * `apps/<name>`. Both layouts may have `tests` and `bench`. Applications,
+         * tests and benchmarks link with every library of the project unless
+         * `<name>.deps` in `ltd.conf` lists the libraries they need. Libraries
+         * depend on nothing unless their own `<name>.deps` says otherwise.
+         */
+        class TargetGraph
+        {
+        private:
+            std::vector<Target> targets;
+
+        public:
+            /**
+             * @brief
+             * Discover the targets of a project.
+             *
+             * @returns err::not_found if a dependency names an unknown library.
+             * @returns err::invalid_state if the library dependencies have a cycle.
+             */
+            err load(const string& project, const string& project_path, const ProjectConfig& config);
+
+            /**
+             * @brief
+             * Get the targets, libraries ordered so that every library comes
+             * after the libraries it depends on.
+             */
+            const std::vector<Target>& get_targets() const;
+
+            /**
+             * @brief
+             * Get the libraries a target links with, including the transitive
+             * ones, in static link order: every library comes before the
+             * libraries it depends on.
+             */
+            string_list link_order(const Target& target) const;
+
+        private:
+            const Target* find_lib(const string& name) const;
+        };
+    } // namespace sdk
+} // namespace ltd
+
+#endif // _LTD_INCLUDE_TARGETS_HPP_
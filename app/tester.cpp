@@ -0,0 +1,454 @@
+#include "tester.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <set>
+#include <stdexcept>
+
+#include "../inc/ltd/cli.hpp"
+#include "../inc/ltd/fmt.hpp"
+
+#include "buildlog.hpp"
+#include "hash.hpp"
+#include "jobs.hpp"
+
+namespace fs = std::filesystem;
+
+namespace ltd
+{
+    namespace sdk
+    {
+        namespace
+        {
+            /**
+             * @brief
+             * A single test process: one case of a test executable, or the whole
+             * executable if it does not report its cases.
+             */
+            struct TestCase
+            {
+                string  binary;
+                int     id = -1;            // Case index, -1 runs the executable as a whole.
+                string  key;                // Hash of the executable, its data and the case.
+                string  output;
+                bool    passed = false;
+                bool    cached = false;     // Passed in an earlier run with the same inputs.
+                int64_t duration = 0;       // Wall time in microseconds.
+            };
+
+            using TestResults = std::map<string,int64_t>;   // Wall time of the passed cases by key.
+
+            void load_results(const string& path, TestResults& results)
+            {
+                std::ifstream file(path);
+
+                string key;
+                int64_t duration;
+                while (file >> key >> duration)
+                    results[key] = duration;
+            }
+
+            err save_results(const string& path, const TestResults& results)
+            {
+                string tmp_path = path + ".tmp";
+
+                {
+                    std::ofstream file(tmp_path, std::ios::trunc);
+                    for (const auto& [key, duration] : results)
+                        file << key << ' ' << duration << '\n';
+
+                    if (!file)
+                        return err::invalid_operation;
+                }
+
+                if (std::rename(tmp_path.c_str(), path.c_str()) != 0)
+                    return err::invalid_operation;
+
+                return err::no_error;
+            }
+
+            void hash_data(Hash& hash, const string& path)
+            {
+                std::error_code ec;
+                hash.update(path);
+
+                if (!fs::is_directory(path, ec)) {
+                    if (hash.update_file(path) != err::no_error)
+                        hash.update(string("<missing>"));
+                    return;
+                }
+
+                string_list entries;
+                for (const auto& dir_entry : fs::directory_iterator(path, ec))
+                    entries.push_back(dir_entry.path());
+
+                std::sort(entries.begin(), entries.end());
+
+                for (const auto& entry : entries)
+                    hash_data(hash, entry);
+            }
+
+            string tested_stamp(const string& build_path)
+            {
+                return build_path + "/.ltd_tested";
+            }
+
+            string canonical(const string& path)
+            {
+                std::error_code ec;
+                return fs::weakly_canonical(path, ec).string();
+            }
+
+            err git_changed_files(const string& project_path, const string& revision, std::set<string>& changed)
+            {
+                Job job;
+                if (run_process(fmt::sprintf("git -C '%s' rev-parse --show-toplevel", project_path), job) != 0) {
+                    cli::error("Project is not a git work tree: %s", project_path);
+                    return err::invalid_argument;
+                }
+
+                string top = split(job.output, "\n").at(0);
+
+                job.output.clear();
+                string command = fmt::sprintf("git -C '%s' diff --name-only '%s' -- && git -C '%s' ls-files --others --exclude-standard --full-name",
+                                              top, revision, top);
+                if (run_process(command, job) != 0) {
+                    cli::error("Unable to diff with revision '%s': %s", revision, job.output);
+                    return err::invalid_argument;
+                }
+
+                for (const auto& line : split(job.output, "\n")) {
+                    if (line.length() > 0)
+                        changed.insert(canonical(top + "/" + line));
+                }
+
+                return err::no_error;
+            }
+
+            string case_name(const TestCase& test)
+            {
+                string name = fs::path(test.binary).filename();
+                return test.id >= 0 ? fmt::sprintf("%s #%d", name, test.id) : name;
+            }
+
+            string format_millis(int64_t micros)
+            {
+                return fmt::sprintf("%d.%d ms", (int)(micros / 1000), (int)(micros / 100 % 10));
+            }
+
+            int parse_count(const string& output)
+            {
+                try {
+                    size_t end = 0;
+                    int count = std::stoi(output, &end);
+
+                    // Anything but the number means the executable ignored -c
+                    if (output.find_first_not_of(" \t\r\n", end) != string::npos)
+                        return -1;
+
+                    return count;
+                } catch (std::exception const& ex)
+                {
+                    return -1;
+                }
+            }
+        }
+
+        err parse_shard(const string& shard, TestOptions& options)
+        {
+            size_t index = shard.find('/');
+            if (index == string::npos) {
+                cli::error("Invalid shard '%s', expected i/n", shard);
+                return err::invalid_argument;
+            }
+
+            int shard_index = 0;
+            int shard_count = 0;
+
+            try {
+                shard_index = std::stoi(shard.substr(0, index));
+                shard_count = std::stoi(shard.substr(index + 1));
+            } catch (std::exception const& ex)
+            {
+                cli::error("Invalid shard '%s', expected i/n", shard);
+                return err::invalid_argument;
+            }
+
+            if (shard_count < 1 || shard_index < 1 || shard_index > shard_count) {
+                cli::error("Invalid shard '%s', i has to be between 1 and n", shard);
+                return err::invalid_argument;
+            }
+
+            options.shard_index = shard_index - 1;
+            options.shard_count = shard_count;
+
+            return err::no_error;
+        }
+
+        string_list list_test_binaries(const string& tests_dir)
+        {
+            string_list binaries;
+
+            std::error_code ec;
+            for (const auto& dir_entry : fs::directory_iterator(tests_dir, ec)) {
+                if (!dir_entry.is_regular_file() || dir_entry.path().has_extension())
+                    continue;
+
+                binaries.push_back(dir_entry.path());
+            }
+
+            std::sort(binaries.begin(), binaries.end());
+
+            return binaries;
+        }
+
+        err run_tests(const string_list& binaries, const TestOptions& options)
+        {
+            JobPool pool(options.jobs);
+
+            // Ask every executable for its number of cases
+            Jobs queries;
+            for (const auto& binary : binaries) {
+                Job job = make_command_job(fs::path(binary).filename(), "", binary + " -c");
+                job.category = "test";
+                queries.push_back(job);
+            }
+
+            bool use_cache = options.cache_path.length() > 0;
+
+            std::vector<int> counts(binaries.size(), -1);
+            std::vector<string> keys(binaries.size());
+
+            for (auto& job : queries) {
+                string command = job.command;
+                size_t index = &job - queries.data();
+
+                string_list data;
+                auto found = options.data.find(fs::path(binaries[index]).filename());
+                if (found != options.data.end())
+                    data = found->second;
+
+                job.action = [command, index, data, use_cache, &binaries, &counts, &keys](Job& self) {
+                    int result = run_process(command, self);
+                    counts[index] = result == 0 ? parse_count(self.output) : -1;
+                    self.output.clear();
+
+                    if (use_cache) {
+                        Hash hash;
+                        hash.update_file(binaries[index]);
+                        for (const auto& input : data)
+                            hash_data(hash, input);
+
+                        keys[index] = hash.hex();
+                    }
+
+                    return 0;
+                };
+            }
+
+            if (pool.run(queries) != err::no_error)
+                return err::invalid_operation;
+
+            TestResults results;
+            if (use_cache)
+                load_results(options.cache_path, results);
+
+            std::vector<TestCase> cases;
+            size_t total = 0;
+
+            for (size_t i = 0; i < binaries.size(); i++) {
+                int count = counts[i] < 0 ? 1 : counts[i];
+
+                for (int id = 0; id < count; id++, total++) {
+                    if (total % options.shard_count != (size_t)options.shard_index)
+                        continue;
+
+                    TestCase test;
+                    test.binary = binaries[i];
+                    test.id     = counts[i] < 0 ? -1 : id;
+
+                    if (use_cache) {
+                        Hash hash;
+                        hash.update(keys[i]);
+                        hash.update((uint64_t)(test.id + 1));
+                        test.key = hash.hex();
+
+                        auto found = results.find(test.key);
+                        if (found != results.end()) {
+                            test.passed   = true;
+                            test.cached   = true;
+                            test.duration = found->second;
+                        }
+                    }
+
+                    cases.push_back(test);
+                }
+            }
+
+            // Failed cases are recorded in the case, the job itself always
+            // succeeds so the pool keeps running the remaining cases
+            Jobs queue;
+            for (auto& test : cases) {
+                if (test.cached)
+                    continue;
+
+                string command = test.id >= 0 ? fmt::sprintf("%s --id=%d", test.binary, test.id) : test.binary;
+
+                Job job;
+                job.name     = case_name(test);
+                job.message  = "Running " + job.name;
+                job.command  = command;
+                job.category = "test";
+                job.action   = [command, &test](Job& self) {
+                    int64_t start = steady_micros();
+                    int result = run_process(command, self);
+                    test.duration = steady_micros() - start;
+
+                    test.output = self.output;
+                    test.passed = result == 0 && (test.id < 0 || test.output.find("-ok-") != string::npos);
+
+                    self.output.clear();
+                    return 0;
+                };
+
+                queue.push_back(job);
+            }
+
+            int64_t start = steady_micros();
+            if (pool.run(queue) != err::no_error)
+                return err::invalid_operation;
+            int64_t wall = steady_micros() - start;
+
+            if (use_cache) {
+                for (const auto& test : cases) {
+                    if (test.passed)
+                        results[test.key] = test.duration;
+                    else
+                        results.erase(test.key);
+                }
+
+                if (save_results(options.cache_path, results) != err::no_error)
+                    cli::warn("Unable to write test results: %s", options.cache_path);
+            }
+
+            int passed = 0;
+            int cached = 0;
+            for (const auto& test : cases) {
+                fmt::println("%s %-32s %10s%s", test.passed ? "PASS" : "FAIL", case_name(test),
+                             format_millis(test.duration), test.cached ? " (cached)" : "");
+
+                if (test.passed) {
+                    passed++;
+                    cached += test.cached ? 1 : 0;
+                    continue;
+                }
+
+                for (const auto& line : split(test.output, "\n")) {
+                    if (line.length() > 0)
+                        fmt::println("     %s", line);
+                }
+            }
+
+            string shard = options.shard_count > 1
+                         ? fmt::sprintf(", shard %d/%d of %d cases", options.shard_index + 1, options.shard_count, (int)total)
+                         : "";
+
+            fmt::println("\n%d passed (%d cached), %d failed, %d cases in %s%s",
+                         passed, cached, (int)cases.size() - passed, (int)cases.size(), format_millis(wall), shard);
+
+            return passed == (int)cases.size() ? err::no_error : err::invalid_state;
+        }
+
+        err select_affected_tests(const string& build_path, const string& project_path,
+                                  const string& revision, string_list& binaries)
+        {
+            BuildLog log(build_path + "/.ltd_log");
+            log.load();
+
+            std::function<bool(const string&)> is_changed;
+
+            std::set<string> changed;
+            if (revision.length() > 0) {
+                err e = git_changed_files(project_path, revision, changed);
+                if (e != err::no_error)
+                    return e;
+
+                is_changed = [&changed](const string& file) { return changed.count(canonical(file)) > 0; };
+            } else {
+                auto stamp_time = log.get_time(tested_stamp(build_path));
+                if (stamp_time == fs::file_time_type::min()) {
+                    cli::info("No successful test run yet, running all tests");
+                    return err::no_error;
+                }
+
+                // Libraries are relinked when any member changes, only their members count
+                is_changed = [&log, stamp_time](const string& file) {
+                    return fs::path(file).extension() != ".a" && log.get_time(file) > stamp_time;
+                };
+            }
+
+            std::map<string,bool> affected;
+
+            std::function<bool(const string&)> visit = [&](const string& input) -> bool {
+                // Library paths may come with a double slash, the log has the plain ones
+                string file = fs::path(input).lexically_normal();
+
+                auto found = affected.find(file);
+                if (found != affected.end())
+                    return found->second;
+
+                // Guards against cycles, a file is not affected by itself
+                affected[file] = false;
+
+                bool result = false;
+
+                string_list inputs;
+                if (log.get_inputs(file, inputs)) {
+                    for (const auto& input : inputs) {
+                        if (visit(input))
+                            result = true;
+                    }
+                }
+
+                if (!result)
+                    result = is_changed(file);
+
+                affected[file] = result;
+                return result;
+            };
+
+            string_list selected;
+            for (const auto& binary : binaries) {
+                string_list inputs;
+                if (!log.get_inputs(binary, inputs)) {
+                    // Not built by ltd, nothing is known about it
+                    selected.push_back(binary);
+                    continue;
+                }
+
+                bool hit = false;
+                for (const auto& input : inputs)
+                    hit = visit(input) || hit;
+
+                if (hit)
+                    selected.push_back(binary);
+            }
+
+            cli::info("%d of %d test executables affected", (int)selected.size(), (int)binaries.size());
+            binaries = selected;
+
+            return err::no_error;
+        }
+
+        void record_tests_passed(const string& build_path)
+        {
+            string path = tested_stamp(build_path);
+            std::ofstream(path).close();
+
+            std::error_code ec;
+            fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+        }
+    } // namespace sdk
+} // namespace ltd
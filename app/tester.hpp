@@ -0,0 +1,88 @@
+#ifndef _LTD_INCLUDE_TESTER_HPP_
+#define _LTD_INCLUDE_TESTER_HPP_
+
+#include <map>
+
+#include "../inc/ltd/stddef.hpp"
+#include "../inc/ltd/err.hpp"
+
+namespace ltd
+{
+    namespace sdk
+    {
+        /**
+         * @brief
+         * Options of `ltd test`.
+         */
+        struct TestOptions
+        {
+            int jobs = 1;           // Number of test cases run in parallel.
+            int shard_index = 0;    // This shard, 0 based, out of `shard_count`.
+            int shard_count = 1;
+
+            string cache_path;      // File of the passed cases, empty to run every case.
+            std::map<string,string_list> data;  // Data inputs of the test executables by name.
+        };
+
+        /**
+         * @brief
+         * Parse a `--shard=i/n` value, `i` counting from 1 to `n`.
+         *
+         * @returns err::invalid_argument if the value is malformed or out of range.
+         */
+        err parse_shard(const string& shard, TestOptions& options);
+
+        /**
+         * @brief
+         * Get the test executables in a build tests directory, the files
+         * without extension next to their objects.
+         */
+        string_list list_test_binaries(const string& tests_dir);
+
+        /**
+         * @brief
+         * Run the cases of test executables in parallel and print a summary.
+         *
+         * @details
+         * Every executable is asked for its number of cases with `-c`, then
+         * every case runs as its own `--id=K` process so a failing case does not
+         * hide the cases after it. A case passes when it exits with 0 and
+         * prints `-ok-`. Executables that do not report a count run as a single
+         * case and pass when they exit with 0. The cases are split over the
+         * shards round robin, in the order of the executables.
+         *
+         * With a cache path, a case that passed before is not run again as long
+         * as its executable and the files and directories of its data inputs
+         * are byte identical, its recorded result is reported instead.
+         *
+         * @returns err::invalid_state if any case failed.
+         */
+        err run_tests(const string_list& binaries, const TestOptions& options);
+
+        /**
+         * @brief
+         * Keep only the test executables affected by changed files.
+         *
+         * @details
+         * The inputs recorded in the build log are followed from every
+         * executable to its objects, the members of the libraries it links
+         * with, and their sources and headers. With a revision, the files that
+         * differ from it in the git work tree, untracked files included, are
+         * the changed files. Without one, the files modified since the last
+         * successful `ltd test` are. Without such a run every executable is kept.
+         *
+         * @returns err::invalid_argument if git does not know the revision.
+         */
+        err select_affected_tests(const string& build_path, const string& project_path,
+                                  const string& revision, string_list& binaries);
+
+        /**
+         * @brief
+         * Remember that all tests of a build passed now, the reference point of
+         * `select_affected_tests` without a revision.
+         */
+        void record_tests_passed(const string& build_path);
+    } // namespace sdk
+} // namespace ltd
+
+#endif // _LTD_INCLUDE_TESTER_HPP_
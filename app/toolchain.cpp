@@ -0,0 +1,248 @@
+#include "toolchain.hpp"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <unistd.h>
+
+#include "../inc/ltd/cli.hpp"
+#include "../inc/ltd/fmt.hpp"
+
+#include "jobs.hpp"
+
+namespace fs = std::filesystem;
+
+namespace ltd
+{
+    namespace sdk
+    {
+        namespace
+        {
+            std::mutex probe_mutex;
+            std::map<string,bool> probe_results;
+
+            // Results read from the probe file, by key, with the binaries they were probed with
+            std::map<string,std::pair<string,bool>> saved_probes;
+            string probes_path;
+            bool probes_changed = false;
+
+            /**
+             * @brief
+             * Identify the compiler and the linker a link probe runs, i.e.
+             * `ld.mold` for `-fuse-ld=mold`.
+             */
+            string probe_stamp(const string& compiler, const string& flags)
+            {
+                string linker = "ld";
+
+                size_t index = flags.rfind("-fuse-ld=");
+                if (index != string::npos) {
+                    string name = flags.substr(index + 9);
+                    linker += "." + name.substr(0, name.find(' '));
+                }
+
+                string stamp;
+                for (const auto& name : { get_compiler_program(compiler), linker }) {
+                    for (const auto& item : find_program(name))
+                        stamp += item + ":";
+                    stamp += ";";
+                }
+
+                return stamp;
+            }
+        }
+
+        string get_compiler_program(const string& compiler)
+        {
+            string_list words;
+            for (const auto& word : split(compiler, " ")) {
+                if (word.length() > 0)
+                    words.push_back(word);
+            }
+
+            for (const auto& word : words) {
+                string name = fs::path(word).filename().string();
+                if (name != "ccache" && name != "sccache" && name != "distcc")
+                    return word;
+            }
+
+            return words.size() > 0 ? words.back() : "";
+        }
+
+        string_list find_program(const string& name)
+        {
+            string_list dirs = { "" };
+            if (name.find('/') == string::npos) {
+                const char* path = getenv("PATH");
+                dirs = split(path != nullptr ? path : "", ":");
+            }
+
+            for (const auto& dir : dirs) {
+                std::error_code ec;
+                fs::path binary = fs::canonical(dir.length() > 0 ? dir + "/" + name : name, ec);
+                if (ec || !fs::is_regular_file(binary, ec))
+                    continue;
+
+                auto time = fs::last_write_time(binary, ec);
+                if (!ec)
+                    return { binary.string(), std::to_string(time.time_since_epoch().count()) };
+            }
+
+            return {};
+        }
+
+        string get_archiver(const string& compiler, bool lto)
+        {
+            if (!lto)
+                return "ar";
+
+            // Keep the path and version suffix, i.e. /usr/bin/g++-12 -> /usr/bin/gcc-ar-12
+            string program = get_compiler_program(compiler);
+
+            size_t index = program.rfind("clang++");
+            if (index != string::npos)
+                return program.replace(index, 7, "llvm-ar");
+
+            index = program.rfind("g++");
+            if (index != string::npos)
+                return program.replace(index, 3, "gcc-ar");
+
+            return "ar";
+        }
+
+        bool is_thin_archive(const string& path)
+        {
+            char magic[8] = {};
+            std::ifstream(path, std::ios::binary).read(magic, sizeof(magic));
+
+            return string(magic, sizeof(magic)) == "!<thin>\n";
+        }
+
+        err flatten_archive(const string& archiver, const string& thin_archive, const string& archive)
+        {
+            Job job;
+            if (run_program({ archiver, "t", thin_archive }, job) != 0) {
+                cli::error("Unable to list the members of %s: %s", thin_archive, job.output);
+                return err::invalid_operation;
+            }
+
+            // Members are stored relative to the archive unless they were given with an absolute path
+            fs::path thin_dir = fs::path(thin_archive).parent_path();
+
+            string_list args = { archiver, "rcs", archive };
+            for (const auto& member : split(job.output, "\n")) {
+                if (member.length() > 0)
+                    args.push_back(fs::path(member).is_absolute() ? member : (thin_dir / member).string());
+            }
+
+            std::error_code ec;
+            fs::remove(archive, ec);
+
+            job.output.clear();
+            if (run_program(args, job) != 0) {
+                cli::error("Unable to flatten %s: %s", thin_archive, job.output);
+                return err::invalid_operation;
+            }
+
+            fs::last_write_time(archive, fs::last_write_time(thin_archive, ec), ec);
+
+            return err::no_error;
+        }
+
+        string find_linker(const string& compiler, const string& requested, const string& flags)
+        {
+            if (requested.length() == 0 || requested == "default")
+                return "";
+
+            string extra_flags = flags.length() > 0 ? " " + flags : "";
+
+            if (requested == "auto") {
+                for (auto linker : { "mold", "lld" }) {
+                    if (supports_link_flags(compiler, fmt::sprintf("-fuse-ld=%s%s", linker, extra_flags)))
+                        return linker;
+                }
+
+                return "";
+            }
+
+            if (!supports_link_flags(compiler, fmt::sprintf("-fuse-ld=%s%s", requested, extra_flags))) {
+                cli::warn("Linker '%s' does not work with %s, using the default linker", requested, compiler);
+                return "";
+            }
+
+            return requested;
+        }
+
+        bool supports_link_flags(const string& compiler, const string& flags)
+        {
+            string key = compiler + " " + flags;
+
+            std::lock_guard<std::mutex> lock(probe_mutex);
+
+            auto found = probe_results.find(key);
+            if (found != probe_results.end())
+                return found->second;
+
+            string stamp = probe_stamp(compiler, flags);
+
+            auto saved = saved_probes.find(key);
+            if (saved != saved_probes.end() && saved->second.first == stamp) {
+                probe_results[key] = saved->second.second;
+                return saved->second.second;
+            }
+
+            string probe = fmt::sprintf("%s/ltd_probe_%d", fs::temp_directory_path().string(), getpid());
+            string command = fmt::sprintf("echo 'int main() { return 0; }' | %s -x c++ - -o %s %s", 
+                                          compiler, probe, flags);
+
+            Job job;
+            bool supported = run_process(command, job) == 0;
+
+            std::error_code ec;
+            fs::remove(probe, ec);
+
+            cli::debug("Link flags '%s' %s", flags, supported ? "supported" : "not supported");
+
+            probe_results[key] = supported;
+            saved_probes[key] = { stamp, supported };
+            probes_changed = true;
+
+            return supported;
+        }
+
+        void load_link_probes(const string& path)
+        {
+            std::lock_guard<std::mutex> lock(probe_mutex);
+
+            saved_probes.clear();
+            probes_path = path;
+            probes_changed = false;
+
+            // One probe per line: key, binaries and result separated by tabs
+            std::ifstream file(path);
+            string line;
+
+            while (std::getline(file, line)) {
+                string_list items = split(line, "\t");
+                if (items.size() == 3)
+                    saved_probes[items[0]] = { items[1], items[2] == "1" };
+            }
+        }
+
+        void save_link_probes()
+        {
+            std::lock_guard<std::mutex> lock(probe_mutex);
+
+            if (!probes_changed || probes_path.length() == 0)
+                return;
+
+            std::ofstream file(probes_path, std::ios::trunc);
+            for (const auto& [key, probe] : saved_probes)
+                file << key << '\t' << probe.first << '\t' << (probe.second ? 1 : 0) << '\n';
+
+            probes_changed = false;
+        }
+    } // namespace sdk
+} // namespace ltd
@@ -0,0 +1,92 @@
+#ifndef _LTD_INCLUDE_TOOLCHAIN_HPP_
+#define _LTD_INCLUDE_TOOLCHAIN_HPP_
+
+#include "../inc/ltd/stddef.hpp"
+#include "../inc/ltd/err.hpp"
+
+namespace ltd
+{
+    namespace sdk
+    {
+        /**
+         * @brief
+         * Get the program a compiler command runs, without its flags. A leading
+         * compiler wrapper like `ccache` is skipped.
+         */
+        string get_compiler_program(const string& compiler);
+
+        /**
+         * @brief
+         * Find a program like `PATH` lookup does and identify it by its real
+         * path and modification time, which change when it is replaced.
+         *
+         * @returns The path and the time, an empty list if it is not found.
+         */
+        string_list find_program(const string& name);
+
+        /**
+         * @brief
+         * Get the archiver to use with a compiler. With link time optimization 
+         * the archive index needs the compiler's LTO plugin, i.e. `gcc-ar` for
+         * `g++` and `llvm-ar` for `clang++`. The archiver is a single program,
+         * flags and wrappers of the compiler command are dropped.
+         */
+        string get_archiver(const string& compiler, bool lto);
+
+        /**
+         * @brief
+         * Check whether an archive is a thin archive, which only refers to its
+         * members by path.
+         */
+        bool is_thin_archive(const string& path);
+
+        /**
+         * @brief
+         * Write a normal archive holding copies of the members of a thin one.
+         * The archive gets the modification time of the thin archive.
+         *
+         * @returns err::invalid_operation if the members can not be listed or
+         *          archived.
+         */
+        err flatten_archive(const string& archiver, const string& thin_archive, const string& archive);
+
+        /**
+         * @brief
+         * Choose the linker passed to the compiler with `-fuse-ld`.
+         *
+         * @details
+         * `auto` picks the first of mold and lld that links with the given 
+         * flags, i.e. LTO flags, and the default linker if neither does. 
+         * `default` or an empty name is the compiler's default linker. A named
+         * linker that does not work falls back to the default with a warning.
+         *
+         * @returns The linker name, empty for the default linker.
+         */
+        string find_linker(const string& compiler, const string& requested, const string& flags);
+
+        /**
+         * @brief
+         * Check whether the compiler can link a program with the given flags.
+         * Every compiler and flags combination is only probed once per ltd run,
+         * or once per build directory with load_link_probes().
+         */
+        bool supports_link_flags(const string& compiler, const string& flags);
+
+        /**
+         * @brief
+         * Read the link probes of earlier runs from a file. A result is only
+         * used while the compiler and linker binaries it was probed with are
+         * unchanged. New results are written back by save_link_probes().
+         */
+        void load_link_probes(const string& path);
+
+        /**
+         * @brief
+         * Write the link probes to the file of load_link_probes() if any were
+         * run since it was read.
+         */
+        void save_link_probes();
+    } // namespace sdk
+} // namespace ltd
+
+#endif // _LTD_INCLUDE_TOOLCHAIN_HPP_
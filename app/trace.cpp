@@ -0,0 +1,227 @@
+#include "trace.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <sstream>
+
+#include "../inc/ltd/cli.hpp"
+#include "../inc/ltd/fmt.hpp"
+
+namespace fs = std::filesystem;
+
+namespace ltd
+{
+    namespace sdk
+    {
+        namespace
+        {
+            string escape_json(const string& text)
+            {
+                string escaped;
+
+                for (char c : text) {
+                    if (c == '"' || c == '\\') {
+                        escaped += '\\';
+                        escaped += c;
+                    } else if ((unsigned char)c < 0x20) {
+                        const char* hex = "0123456789abcdef";
+                        escaped += "\\u00";
+                        escaped += hex[(c >> 4) & 0xf];
+                        escaped += hex[c & 0xf];
+                    } else {
+                        escaped += c;
+                    }
+                }
+
+                return escaped;
+            }
+
+            /**
+             * @brief
+             * Split the `traceEvents` array of a trace file into its event 
+             * objects, without parsing them.
+             */
+            string_list split_events(const string& json)
+            {
+                string_list objects;
+
+                size_t index = json.find("\"traceEvents\"");
+                if (index == string::npos)
+                    return objects;
+
+                index = json.find('[', index);
+                if (index == string::npos)
+                    return objects;
+
+                int depth = 0;
+                bool in_string = false;
+                size_t begin = 0;
+
+                for (size_t i = index + 1; i < json.length(); i++) {
+                    char c = json[i];
+
+                    if (in_string) {
+                        if (c == '\\')
+                            i++;
+                        else if (c == '"')
+                            in_string = false;
+                        continue;
+                    }
+
+                    if (c == '"') {
+                        in_string = true;
+                    } else if (c == '{') {
+                        if (depth++ == 0)
+                            begin = i;
+                    } else if (c == '}') {
+                        if (--depth == 0)
+                            objects.push_back(json.substr(begin, i - begin + 1));
+                    } else if (c == ']' && depth == 0) {
+                        break;
+                    }
+                }
+
+                return objects;
+            }
+        }
+
+        namespace
+        {
+            /**
+             * @brief
+             * Find the number value of a field in an event object.
+             *
+             * @returns The position and length of the value, npos if not found.
+             */
+            std::pair<size_t,size_t> find_field(const string& object, const string& name)
+            {
+                size_t index = object.find("\"" + name + "\":");
+                if (index == string::npos)
+                    return { string::npos, 0 };
+
+                size_t begin = object.find_first_not_of(" ", index + name.length() + 3);
+                if (begin == string::npos)
+                    return { string::npos, 0 };
+
+                size_t end = object.find_first_not_of("-0123456789", begin);
+                if (end == string::npos || end == begin)
+                    return { string::npos, 0 };
+
+                return { begin, end - begin };
+            }
+
+            bool read_field(const string& object, const string& name, int64_t& value)
+            {
+                auto [begin, length] = find_field(object, name);
+                if (begin == string::npos)
+                    return false;
+
+                value = std::stoll(object.substr(begin, length));
+                return true;
+            }
+
+            void write_field(string& object, const string& name, int64_t value)
+            {
+                auto [begin, length] = find_field(object, name);
+                if (begin != string::npos)
+                    object.replace(begin, length, std::to_string(value));
+            }
+        }
+
+        BuildTrace::BuildTrace(const string& path)
+        {
+            this->path = path;
+            epoch = steady_micros();
+        }
+
+        void BuildTrace::add_jobs(const Jobs& jobs)
+        {
+            std::set<int> slots;
+
+            for (const auto& job : jobs) {
+                // Not started because the build failed before
+                if (job.slot < 0)
+                    continue;
+
+                slots.insert(job.slot);
+
+                events.push_back(fmt::sprintf(
+                    "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%d,\"dur\":%d,"
+                    "\"args\":{\"target\":\"%s\",\"exit_code\":%d,\"user_ms\":%d,\"system_ms\":%d,\"max_rss_kb\":%d,"
+                    "\"command\":\"%s\"}}",
+                    escape_json(job.name), job.category, job.slot, job.start_time - epoch, 
+                    job.end_time - job.start_time, escape_json(job.target), job.exit_code, 
+                    job.user_time / 1000, job.system_time / 1000, job.max_rss, escape_json(job.command)));
+
+                if (job.category == "compile" && job.target.length() > 0) {
+                    string time_trace = fs::path(job.target).replace_extension(".json");
+
+                    std::error_code ec;
+                    if (fs::exists(time_trace, ec))
+                        add_time_trace(time_trace, job);
+                }
+            }
+
+            for (auto slot : slots) {
+                events.push_back(fmt::sprintf(
+                    "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"worker %d\"}}", 
+                    slot, slot));
+            }
+        }
+
+        void BuildTrace::add_time_trace(const string& file, const Job& job)
+        {
+            std::ifstream in(file);
+            std::stringstream buffer;
+            buffer << in.rdbuf();
+
+            string_list objects = split_events(buffer.str());
+
+            // Clang counts from its own start, align the report with the end of the job
+            int64_t length = 0;
+            for (const auto& object : objects) {
+                int64_t ts, dur;
+                if (read_field(object, "ts", ts) && read_field(object, "dur", dur))
+                    length = std::max(length, ts + dur);
+            }
+
+            int64_t offset = job.end_time - epoch - length;
+
+            for (auto object : objects) {
+                // Process and thread names of clang would rename the worker lanes
+                if (object.find("\"ph\":\"M\"") != string::npos)
+                    continue;
+
+                int64_t ts;
+                if (!read_field(object, "ts", ts))
+                    continue;
+
+                write_field(object, "ts", ts + offset);
+                write_field(object, "pid", 1);
+                write_field(object, "tid", job.slot);
+
+                events.push_back(object);
+            }
+        }
+
+        err BuildTrace::save() const
+        {
+            std::ofstream file(path, std::ios::trunc);
+            if (!file) {
+                cli::error("Unable to write the trace: %s", path);
+                return err::invalid_operation;
+            }
+
+            file << "{\"traceEvents\":[\n";
+            for (size_t i = 0; i < events.size(); i++) 
+                file << events[i] << (i + 1 < events.size() ? ",\n" : "\n");
+            file << "],\"displayTimeUnit\":\"ms\"}\n";
+
+            cli::info("Trace written to: %s", path);
+
+            return err::no_error;
+        }
+    } // namespace sdk
+} // namespace ltd
@@ -0,0 +1,55 @@
+#ifndef _LTD_INCLUDE_TRACE_HPP_
+#define _LTD_INCLUDE_TRACE_HPP_
+
+#include <vector>
+
+#include "../inc/ltd/stddef.hpp"
+#include "../inc/ltd/err.hpp"
+
+#include "jobs.hpp"
+
+namespace ltd
+{
+    namespace sdk
+    {
+        /**
+         * @brief
+         * Timeline of a build in the Chrome trace event format, viewable in 
+         * `chrome://tracing` or Perfetto.
+         *
+         * @details
+         * Every job is a complete event on the lane of its worker slot, with 
+         * its exit code, CPU time and peak memory as arguments. The clang 
+         * `-ftime-trace` report of a compile job, if any, is merged into the
+         * same lane, aligned to the end of the job.
+         */
+        class BuildTrace
+        {
+        private:
+            string path;
+            int64_t epoch;      // Start of the build, trace times are relative to it.
+
+            std::vector<string> events;
+
+        public:
+            BuildTrace(const string& path);
+
+            /**
+             * @brief
+             * Add the jobs that ran, after the job pool finished.
+             */
+            void add_jobs(const Jobs& jobs);
+
+            /**
+             * @brief
+             * Write the trace file.
+             */
+            err save() const;
+
+        private:
+            void add_time_trace(const string& file, const Job& job);
+        };
+    } // namespace sdk
+} // namespace ltd
+
+#endif // _LTD_INCLUDE_TRACE_HPP_
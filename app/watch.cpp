@@ -0,0 +1,228 @@
+#include "watch.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <filesystem>
+
+#include <poll.h>
+#include <spawn.h>
+#include <sys/inotify.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../inc/ltd/cli.hpp"
+#include "../inc/ltd/fmt.hpp"
+
+#include "tester.hpp"
+
+namespace fs = std::filesystem;
+
+extern char **environ;
+
+namespace ltd
+{
+    namespace sdk
+    {
+        namespace
+        {
+            const uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | 
+                                        IN_MOVED_TO | IN_ATTRIB;
+
+            // Swap and backup files of editors
+            bool is_ignored(const string& name)
+            {
+                return name.length() == 0 || name.at(0) == '.' || name.back() == '~' || name == "4913";
+            }
+
+            /**
+             * @brief
+             * Run a command line with the shell, which is replaced by the
+             * program, so stop_process() signals the program itself.
+             */
+            pid_t start_process(const string& command)
+            {
+                string line = "exec " + command;
+                const char *argv[] = { "/bin/sh", "-c", line.c_str(), nullptr };
+
+                pid_t pid;
+                if (posix_spawn(&pid, "/bin/sh", nullptr, nullptr, (char* const*)argv, environ) != 0)
+                    return -1;
+
+                return pid;
+            }
+
+            void stop_process(pid_t pid)
+            {
+                if (pid <= 0)
+                    return;
+
+                kill(pid, SIGTERM);
+
+                int status;
+                while (waitpid(pid, &status, 0) < 0 && errno == EINTR);
+            }
+        }
+
+        Watcher::Watcher()
+        {
+            fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+        }
+
+        Watcher::~Watcher()
+        {
+            if (fd >= 0)
+                close(fd);
+        }
+
+        err Watcher::add_tree(const string& path)
+        {
+            if (fd < 0)
+                return err::invalid_operation;
+
+            int wd = inotify_add_watch(fd, path.c_str(), WATCH_MASK);
+            if (wd < 0)
+                return err::not_found;
+
+            dirs[wd] = path;
+
+            std::error_code ec;
+            for (const auto& dir_entry : fs::directory_iterator(path, ec)) {
+                string name = dir_entry.path().filename();
+
+                if (dir_entry.is_directory() && !is_ignored(name))
+                    add_tree(dir_entry.path());
+            }
+
+            return err::no_error;
+        }
+
+        void Watcher::read_events(string_list& changed)
+        {
+            alignas(struct inotify_event) char buffer[16384];
+
+            ssize_t count;
+            while ((count = read(fd, buffer, sizeof(buffer))) > 0) {
+                for (char* ptr = buffer; ptr < buffer + count; ) {
+                    auto event = (struct inotify_event*)ptr;
+                    ptr += sizeof(struct inotify_event) + event->len;
+
+                    auto found = dirs.find(event->wd);
+                    if (found == dirs.end() || event->len == 0 || is_ignored(event->name))
+                        continue;
+
+                    string file = found->second + "/" + event->name;
+
+                    if ((event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_MOVED_TO)))
+                        add_tree(file);
+
+                    // A new or removed file changes the directory listing too
+                    if (event->mask & (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO))
+                        changed.push_back(found->second);
+
+                    changed.push_back(file);
+                }
+            }
+        }
+
+        err Watcher::wait(string_list& changed, int debounce_ms)
+        {
+            if (fd < 0)
+                return err::invalid_operation;
+
+            struct pollfd pfd = { fd, POLLIN, 0 };
+            int timeout = -1;
+
+            while (true) {
+                int result = poll(&pfd, 1, timeout);
+
+                if (result < 0) {
+                    if (errno == EINTR)
+                        continue;
+                    return err::invalid_operation;
+                }
+
+                if (result == 0 && changed.size() > 0)
+                    break;
+
+                read_events(changed);
+
+                if (changed.size() > 0)
+                    timeout = debounce_ms;
+            }
+
+            std::sort(changed.begin(), changed.end());
+            changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+
+            return err::no_error;
+        }
+
+        err watch_project(const BuildOptions& options, const WatchOptions& watch_options)
+        {
+            string project_path = get_active_project_path();
+            string build_dir = get_active_build_path(options.profile);
+
+            Watcher watcher;
+
+            // The whole project is watched, so libs/ and apps/ subprojects are covered
+            if (watcher.add_tree(project_path) != err::no_error) {
+                cli::error("Unable to watch: %s", project_path);
+                return err::invalid_operation;
+            }
+
+            BuildState state;
+            pid_t running = -1;
+
+            while (true) {
+                stop_process(running);
+                running = -1;
+
+                if (build_project(options, state) == err::no_error) {
+                    if (watch_options.test) {
+                        string_list tests;
+                        for (const auto& output : state.built) {
+                            // Test executables are the outputs without extension, next to their objects
+                            fs::path path = output;
+                            if (path.parent_path() == fs::path(build_dir + "/tests") && !path.has_extension())
+                                tests.push_back(output);
+                        }
+
+                        if (tests.size() > 0) {
+                            TestOptions test_options;
+                            test_options.jobs = options.jobs;
+
+                            run_tests(tests, test_options);
+                        }
+                    }
+
+                    if (watch_options.run.length() > 0) {
+                        string command = fmt::sprintf("%s/target/%s %s", build_dir, watch_options.run, watch_options.run_args);
+                        cli::info("Running: %s", command);
+
+                        running = start_process(command);
+                    }
+                } else {
+                    cli::error("Build failed.");
+                }
+
+                cli::info("Watching %s for changes...", project_path);
+
+                string_list changed;
+                if (watcher.wait(changed, watch_options.debounce) != err::no_error) {
+                    stop_process(running);
+                    return err::invalid_operation;
+                }
+
+                for (const auto& file : changed) {
+                    cli::debug("Changed: %s", file);
+
+                    if (state.log)
+                        state.log->invalidate(file);
+                }
+            }
+
+            return err::no_error;
+        }
+    } // namespace sdk
+} // namespace ltd
@@ -0,0 +1,74 @@
+#ifndef _LTD_INCLUDE_WATCH_HPP_
+#define _LTD_INCLUDE_WATCH_HPP_
+
+#include <map>
+
+#include "../inc/ltd/stddef.hpp"
+#include "../inc/ltd/err.hpp"
+
+#include "sdk.hpp"
+
+namespace ltd
+{
+    namespace sdk
+    {
+        /**
+         * @brief
+         * Watches directory trees for changes with inotify.
+         */
+        class Watcher
+        {
+        private:
+            int fd = -1;
+            std::map<int,string> dirs;      // Watched directory of every watch descriptor.
+
+        public:
+            Watcher();
+            ~Watcher();
+
+            /**
+             * @brief
+             * Watch a directory and all its subdirectories. Directories created
+             * later are watched as soon as they show up.
+             *
+             * @returns err::invalid_operation if inotify is not available.
+             */
+            err add_tree(const string& path);
+
+            /**
+             * @brief
+             * Wait for changes. After the first change, changes are collected
+             * until there was none for `debounce_ms`, so a burst of saves is
+             * reported at once.
+             *
+             * @param changed Receives the changed files and directories.
+             */
+            err wait(string_list& changed, int debounce_ms);
+
+        private:
+            void read_events(string_list& changed);
+        };
+
+        /**
+         * @brief
+         * Options of `ltd watch` on top of the build options.
+         */
+        struct WatchOptions
+        {
+            string run;             // Executable restarted after every successful build.
+            string run_args;
+            bool   test = false;    // Run the relinked unit tests after every build.
+            int    debounce = 150;  // Quiet time in milliseconds ending a burst of changes.
+        };
+
+        /**
+         * @brief
+         * Build the active project, then rebuild it whenever its sources change.
+         * The build log stays in memory between the builds, so only the files
+         * reported by inotify are checked again.
+         */
+        err watch_project(const BuildOptions& options, const WatchOptions& watch_options);
+    } // namespace sdk
+} // namespace ltd
+
+#endif // _LTD_INCLUDE_WATCH_HPP_
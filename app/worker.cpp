@@ -0,0 +1,677 @@
+#include "worker.hpp"
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../inc/ltd/cli.hpp"
+#include "../inc/ltd/fmt.hpp"
+
+namespace fs = std::filesystem;
+
+extern char **environ;
+
+namespace ltd
+{
+    namespace sdk
+    {
+        namespace
+        {
+            const uint32_t MAX_FIELD_SIZE  = 64 * 1024;         // Requests, flags, exit codes.
+            const uint32_t MAX_SOURCE_SIZE = 256 * 1024 * 1024; // Preprocessed sources, outputs and objects.
+            const int MAX_CONNECTIONS_PER_SLOT = 4;
+            const int CONNECT_TIMEOUT_MS = 2000;
+            const int IO_TIMEOUT_SECONDS = 600;     // A single compilation may take long.
+
+            bool write_all(int fd, const char* data, size_t size)
+            {
+                while (size > 0) {
+                    ssize_t count = send(fd, data, size, MSG_NOSIGNAL);
+                    if (count < 0) {
+                        if (errno == EINTR)
+                            continue;
+                        return false;
+                    }
+
+                    data += count;
+                    size -= count;
+                }
+
+                return true;
+            }
+
+            bool read_all(int fd, char* data, size_t size)
+            {
+                while (size > 0) {
+                    ssize_t count = recv(fd, data, size, 0);
+                    if (count < 0 && errno == EINTR)
+                        continue;
+                    if (count <= 0)
+                        return false;
+
+                    data += count;
+                    size -= count;
+                }
+
+                return true;
+            }
+
+            bool send_frame(int fd, const string& data)
+            {
+                uint32_t size = htonl(data.size());
+                return write_all(fd, (const char*)&size, sizeof(size)) && write_all(fd, data.data(), data.size());
+            }
+
+            bool recv_frame(int fd, string& data, uint32_t max_size = MAX_FIELD_SIZE)
+            {
+                uint32_t size;
+                if (!read_all(fd, (char*)&size, sizeof(size)))
+                    return false;
+
+                size = ntohl(size);
+                if (size > max_size)
+                    return false;
+
+                data.resize(size);
+                return read_all(fd, data.data(), size);
+            }
+
+            bool is_unix_address(const string& address)
+            {
+                return address.length() > 0 && (address.at(0) == '/' || address.at(0) == '.');
+            }
+
+            bool to_unix_address(const string& address, struct sockaddr_un& addr)
+            {
+                std::memset(&addr, 0, sizeof(addr));
+                addr.sun_family = AF_UNIX;
+
+                if (address.length() >= sizeof(addr.sun_path))
+                    return false;
+
+                std::strncpy(addr.sun_path, address.c_str(), sizeof(addr.sun_path) - 1);
+                return true;
+            }
+
+            struct addrinfo* resolve(const string& address, bool passive)
+            {
+                size_t index = address.find_last_of(':');
+                if (index == string::npos)
+                    return nullptr;
+
+                string host = address.substr(0, index);
+                string port = address.substr(index + 1);
+
+                struct addrinfo hints;
+                std::memset(&hints, 0, sizeof(hints));
+                hints.ai_family   = AF_UNSPEC;
+                hints.ai_socktype = SOCK_STREAM;
+                hints.ai_flags    = passive ? AI_PASSIVE : 0;
+
+                struct addrinfo* result = nullptr;
+                if (getaddrinfo(host.length() > 0 ? host.c_str() : nullptr, port.c_str(), &hints, &result) != 0)
+                    return nullptr;
+
+                return result;
+            }
+
+            bool connect_with_timeout(int fd, const struct sockaddr* addr, socklen_t length)
+            {
+                int flags = fcntl(fd, F_GETFL);
+                fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+
+                bool connected = connect(fd, addr, length) == 0;
+                if (!connected && errno == EINPROGRESS) {
+                    struct pollfd pfd = { fd, POLLOUT, 0 };
+
+                    int error = 0;
+                    socklen_t error_length = sizeof(error);
+
+                    connected = poll(&pfd, 1, CONNECT_TIMEOUT_MS) == 1 &&
+                                getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &error_length) == 0 && error == 0;
+                }
+
+                fcntl(fd, F_SETFL, flags);
+
+                return connected;
+            }
+
+            int connect_address(const string& address)
+            {
+                int fd = -1;
+
+                if (is_unix_address(address)) {
+                    struct sockaddr_un addr;
+                    if (!to_unix_address(address, addr))
+                        return -1;
+
+                    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+                    if (fd >= 0 && !connect_with_timeout(fd, (struct sockaddr*)&addr, sizeof(addr))) {
+                        close(fd);
+                        fd = -1;
+                    }
+                } else {
+                    struct addrinfo* infos = resolve(address, false);
+
+                    for (auto info = infos; info != nullptr && fd < 0; info = info->ai_next) {
+                        fd = socket(info->ai_family, info->ai_socktype | SOCK_CLOEXEC, info->ai_protocol);
+                        if (fd >= 0 && !connect_with_timeout(fd, info->ai_addr, info->ai_addrlen)) {
+                            close(fd);
+                            fd = -1;
+                        }
+                    }
+
+                    if (infos != nullptr)
+                        freeaddrinfo(infos);
+                }
+
+                if (fd >= 0) {
+                    struct timeval timeout = { IO_TIMEOUT_SECONDS, 0 };
+                    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+                    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+                }
+
+                return fd;
+            }
+
+            int listen_address(const string& address)
+            {
+                int fd = -1;
+
+                if (is_unix_address(address)) {
+                    struct sockaddr_un addr;
+                    if (!to_unix_address(address, addr))
+                        return -1;
+
+                    // A socket file left by a killed worker
+                    unlink(address.c_str());
+
+                    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+                    if (fd >= 0 && bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+                        close(fd);
+                        fd = -1;
+                    }
+
+                    // Only the user running the worker may connect
+                    if (fd >= 0)
+                        chmod(address.c_str(), 0600);
+                } else {
+                    struct addrinfo* infos = resolve(address, true);
+
+                    for (auto info = infos; info != nullptr && fd < 0; info = info->ai_next) {
+                        fd = socket(info->ai_family, info->ai_socktype | SOCK_CLOEXEC, info->ai_protocol);
+                        if (fd < 0)
+                            continue;
+
+                        int reuse = 1;
+                        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+                        if (bind(fd, info->ai_addr, info->ai_addrlen) != 0) {
+                            close(fd);
+                            fd = -1;
+                        }
+                    }
+
+                    if (infos != nullptr)
+                        freeaddrinfo(infos);
+                }
+
+                if (fd >= 0 && listen(fd, 64) != 0) {
+                    close(fd);
+                    fd = -1;
+                }
+
+                return fd;
+            }
+
+            string compiler_version(const string& compiler)
+            {
+                Job job;
+                if (run_program({ compiler, "--version" }, job) != 0)
+                    return "";
+
+                return job.output.substr(0, job.output.find('\n'));
+            }
+
+            string get_secret()
+            {
+                const char* secret = getenv("LTD_WORKER_SECRET");
+                return secret != nullptr ? secret : "";
+            }
+
+            // Compares in constant time, the time taken tells nothing about the secret
+            bool is_same_secret(const string& expected, const string& received)
+            {
+                unsigned char difference = expected.size() != received.size();
+                for (size_t i = 0; i < expected.size(); i++)
+                    difference |= expected[i] ^ (i < received.size() ? received[i] : 0);
+
+                return difference == 0;
+            }
+
+            /**
+             * @brief
+             * Check a compiler flag against the flags a worker runs: flags that
+             * only change the code generated, none naming a file, a directory
+             * or a program, nor passing options on to other tools.
+             */
+            bool is_allowed_flag(const string& flag)
+            {
+                static const string_list flags = { 
+                    "-pthread", "-w", "-flto", "-flto=auto", "-ffunction-sections", "-fdata-sections", 
+                    "-fPIC", "-fpic", "-fPIE", "-fpie", "-fexceptions", "-frtti", "-fomit-frame-pointer", 
+                    "-fstrict-aliasing", "-ffast-math", "-fopenmp", "-fcoroutines"
+                };
+                static const string_list prefixes = { 
+                    "-std=", "-O", "-g", "-D", "-U", "-W", "-m", "-fno-", "-fvisibility=", 
+                    "-fstack-protector", "-fsanitize=", "-fcf-protection"
+                };
+
+                // Quotes were meant for a shell, the worker runs no shell
+                if (flag.find_first_of("\"'\\") != string::npos)
+                    return false;
+
+                // Options of the assembler, the linker and the preprocessor
+                if (flag.compare(0, 4, "-Wa,") == 0 || flag.compare(0, 4, "-Wl,") == 0 || flag.compare(0, 4, "-Wp,") == 0)
+                    return false;
+
+                for (const auto& allowed : flags) {
+                    if (flag == allowed)
+                        return true;
+                }
+
+                for (const auto& prefix : prefixes) {
+                    if (flag.length() > prefix.length() && flag.compare(0, prefix.length(), prefix) == 0)
+                        return true;
+                }
+
+                return false;
+            }
+
+            bool parse_flags(const string& flags, string_list& args)
+            {
+                for (const auto& flag : split(flags, " ")) {
+                    if (flag.length() == 0)
+                        continue;
+
+                    if (!is_allowed_flag(flag)) {
+                        cli::warn("Refused compiler flag: %s", flag);
+                        return false;
+                    }
+
+                    args.push_back(flag);
+                }
+
+                return true;
+            }
+
+            void compile_request(int fd, const string& compiler, int slots, std::atomic<int>& active)
+            {
+                string flags;
+                if (!recv_frame(fd, flags))
+                    return;
+
+                // The compiler is the one of the worker, the flags only add to it
+                string_list args = { compiler };
+                if (!parse_flags(flags, args)) {
+                    send_frame(fd, "error");
+                    return;
+                }
+
+                // Refused before the source is sent, the caller compiles it locally
+                if (active.fetch_add(1) >= slots) {
+                    active--;
+                    send_frame(fd, "busy");
+                    return;
+                }
+
+                string source;
+                if (!send_frame(fd, "ready") || !recv_frame(fd, source, MAX_SOURCE_SIZE)) {
+                    active--;
+                    return;
+                }
+
+                char temp_dir[] = "/tmp/ltd-worker-XXXXXX";
+                if (mkdtemp(temp_dir) == nullptr) {
+                    active--;
+                    send_frame(fd, "error");
+                    return;
+                }
+
+                string src = string(temp_dir) + "/source.ii";
+                string obj = string(temp_dir) + "/source.o";
+
+                std::ofstream(src, std::ios::binary) << source;
+
+                args.insert(args.end(), { "-c", src, "-o", obj });
+
+                Job job;
+                int result = run_program(args, job);
+
+                active--;
+
+                string object;
+                if (result == 0) {
+                    std::ifstream in(obj, std::ios::binary);
+                    std::stringstream content;
+                    content << in.rdbuf();
+                    object = content.str();
+                }
+
+                std::error_code ec;
+                fs::remove_all(temp_dir, ec);
+
+                cli::debug("Compiled %d bytes, exit code %d", (int)source.size(), result);
+
+                send_frame(fd, "ok") && send_frame(fd, std::to_string(result)) &&
+                send_frame(fd, job.output) && send_frame(fd, object);
+            }
+
+            void serve_connection(int fd, const string& compiler, const string& version, int slots, 
+                                  std::atomic<int>& active, std::atomic<int>& connections)
+            {
+                struct timeval timeout = { IO_TIMEOUT_SECONDS, 0 };
+                setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+                setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+                string secret, request;
+                if (recv_frame(fd, secret) && recv_frame(fd, request)) {
+                    if (!is_same_secret(get_secret(), secret)) {
+                        cli::warn("Refused a request with the wrong secret");
+                        send_frame(fd, "denied");
+                    } else if (request == "status") {
+                        send_frame(fd, "ok") && send_frame(fd, std::to_string(slots)) && send_frame(fd, version);
+                    } else if (request == "compile") {
+                        compile_request(fd, compiler, slots, active);
+                    }
+                }
+
+                close(fd);
+                connections--;
+            }
+        }
+
+        CompileWorkers::CompileWorkers(const string& compiler, const string_list& addresses)
+        {
+            this->compiler = compiler;
+
+            for (const auto& address : addresses) {
+                Worker worker;
+                worker.address = address;
+                workers.push_back(worker);
+            }
+        }
+
+        int CompileWorkers::probe()
+        {
+            string version = compiler_version(compiler);
+            int slots = 0;
+
+            for (auto& worker : workers) {
+                worker.down = true;
+
+                int fd = connect_address(worker.address);
+                if (fd < 0) {
+                    cli::warn("Compile worker not reachable: %s", worker.address);
+                    continue;
+                }
+
+                string status, worker_slots, worker_version;
+                bool received = send_frame(fd, get_secret()) && send_frame(fd, "status") && recv_frame(fd, status);
+                if (received && status == "ok")
+                    received = recv_frame(fd, worker_slots) && recv_frame(fd, worker_version);
+                close(fd);
+
+                if (received && status == "denied") {
+                    cli::warn("Compile worker refused the secret, check LTD_WORKER_SECRET: %s", worker.address);
+                    continue;
+                }
+
+                if (!received || status != "ok") {
+                    cli::warn("Compile worker did not answer: %s", worker.address);
+                    continue;
+                }
+
+                // Objects have to be the same as if they were compiled locally
+                if (worker_version != version) {
+                    cli::warn("Compile worker %s has a different compiler: %s", worker.address, worker_version);
+                    continue;
+                }
+
+                worker.slots = std::atoi(worker_slots.c_str());
+                worker.down  = worker.slots <= 0;
+
+                if (!worker.down) {
+                    cli::debug("Compile worker %s: %d slots", worker.address, worker.slots);
+                    slots += worker.slots;
+                }
+            }
+
+            return slots;
+        }
+
+        int CompileWorkers::acquire()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            // The worker with the lowest share of busy slots
+            int best = -1;
+            for (size_t i = 0; i < workers.size(); i++) {
+                const Worker& worker = workers[i];
+                if (worker.down || worker.active >= worker.slots)
+                    continue;
+
+                if (best < 0 || worker.active * workers[best].slots < workers[best].active * worker.slots)
+                    best = i;
+            }
+
+            if (best >= 0)
+                workers[best].active++;
+
+            return best;
+        }
+
+        void CompileWorkers::release(int index, bool failed)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            workers[index].active--;
+
+            if (failed && !workers[index].down) {
+                cli::warn("Compile worker failed, compiling locally: %s", workers[index].address);
+                workers[index].down = true;
+            }
+        }
+
+        bool CompileWorkers::compile(const string& flags, const string& preprocessed, const string& obj, Job& job)
+        {
+            std::ifstream in(preprocessed, std::ios::binary);
+            if (!in)
+                return false;
+
+            std::stringstream source;
+            source << in.rdbuf();
+
+            int index = acquire();
+            if (index < 0)
+                return false;
+
+            int fd = connect_address(workers[index].address);
+            if (fd < 0) {
+                release(index, true);
+                return false;
+            }
+
+            string status, exit_code, output, object;
+            bool received = send_frame(fd, get_secret()) && send_frame(fd, "compile") && 
+                            send_frame(fd, flags) && recv_frame(fd, status);
+
+            if (received && status == "ready")
+                received = send_frame(fd, source.str()) && recv_frame(fd, status);
+
+            if (received && status == "ok") {
+                received = recv_frame(fd, exit_code) && recv_frame(fd, output, MAX_SOURCE_SIZE) && 
+                           recv_frame(fd, object, MAX_SOURCE_SIZE);
+            }
+
+            close(fd);
+
+            // Busy with other builds is not a failure of the worker
+            release(index, !received || (status != "ok" && status != "busy"));
+
+            // Compile errors are reported by the local compiler
+            if (!received || status != "ok" || exit_code != "0")
+                return false;
+
+            std::ofstream out(obj, std::ios::binary | std::ios::trunc);
+            out << object;
+            out.close();
+
+            if (!out)
+                return false;
+
+            job.output += output;
+
+            return true;
+        }
+
+        LocalWorkers::~LocalWorkers()
+        {
+            for (auto pid : pids) {
+                kill(pid, SIGTERM);
+
+                int status;
+                waitpid(pid, &status, 0);
+            }
+
+            for (const auto& address : addresses)
+                unlink(address.c_str());
+        }
+
+        err LocalWorkers::start(int count)
+        {
+            for (int i = 0; i < count; i++) {
+                string address = fmt::sprintf("/tmp/ltd-worker-%d-%d.sock", (int)getpid(), i);
+                string listen = "--listen=" + address;
+
+                const char *argv[] = { "ltd", "worker", listen.c_str(), "--jobs=1", nullptr };
+
+                pid_t pid;
+                if (posix_spawn(&pid, "/proc/self/exe", nullptr, nullptr, (char* const*)argv, environ) != 0) {
+                    cli::error("Unable to start a local compile worker");
+                    return err::invalid_operation;
+                }
+
+                pids.push_back(pid);
+                addresses.push_back(address);
+            }
+
+            // Wait until every worker accepts connections
+            for (const auto& address : addresses) {
+                int fd = -1;
+                for (int tries = 0; tries < 100 && fd < 0; tries++) {
+                    fd = connect_address(address);
+                    if (fd < 0)
+                        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                }
+
+                if (fd < 0) {
+                    cli::error("Local compile worker did not start: %s", address);
+                    return err::invalid_operation;
+                }
+
+                close(fd);
+            }
+
+            return err::no_error;
+        }
+
+        const string_list& LocalWorkers::get_addresses() const
+        {
+            return addresses;
+        }
+
+        string_list parse_worker_addresses(const string& list)
+        {
+            string_list addresses;
+
+            for (const auto& address : split(list, ",")) {
+                if (address.length() > 0)
+                    addresses.push_back(address);
+            }
+
+            return addresses;
+        }
+
+        err run_worker(const string& address, const string& compiler, int slots)
+        {
+            if (!is_unix_address(address) && get_secret().length() == 0) {
+                cli::error("A worker listening on %s needs the LTD_WORKER_SECRET of its builds", address);
+                return err::invalid_argument;
+            }
+
+            string version = compiler_version(compiler);
+            if (version.length() == 0) {
+                cli::error("Unable to run the compiler of the worker: %s", compiler);
+                return err::invalid_argument;
+            }
+
+            int fd = listen_address(address);
+            if (fd < 0) {
+                cli::error("Unable to listen on %s", address);
+                return err::invalid_argument;
+            }
+
+            std::signal(SIGPIPE, SIG_IGN);
+
+            std::atomic<int> active(0);
+            std::atomic<int> connections(0);
+            slots = slots > 0 ? slots : 1;
+
+            cli::info("Compile worker listening on %s with %d slots, %s", address, slots, version);
+
+            while (true) {
+                int client = accept4(fd, nullptr, nullptr, SOCK_CLOEXEC);
+                if (client < 0) {
+                    if (errno == EINTR || errno == ECONNABORTED)
+                        continue;
+
+                    cli::error("Compile worker stopped: %s", std::strerror(errno));
+                    break;
+                }
+
+                // Every connection holds a thread, and up to a source, until it is done
+                if (connections.fetch_add(1) >= slots * MAX_CONNECTIONS_PER_SLOT) {
+                    connections--;
+                    close(client);
+                    continue;
+                }
+
+                std::thread(serve_connection, client, compiler, version, slots, 
+                            std::ref(active), std::ref(connections)).detach();
+            }
+
+            close(fd);
+
+            return err::invalid_operation;
+        }
+    } // namespace sdk
+} // namespace ltd
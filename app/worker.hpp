@@ -0,0 +1,134 @@
+#ifndef _LTD_INCLUDE_WORKER_HPP_
+#define _LTD_INCLUDE_WORKER_HPP_
+
+#include <mutex>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "../inc/ltd/stddef.hpp"
+#include "../inc/ltd/err.hpp"
+
+#include "jobs.hpp"
+
+namespace ltd
+{
+    namespace sdk
+    {
+        /**
+         * @brief
+         * Compiles preprocessed sources for `ltd build` on other machines or
+         * processes.
+         *
+         * @details
+         * A worker address is either a Unix socket path, starting with '/' or
+         * '.', or `host:port` for TCP. Every request is a connection of its own
+         * carrying length prefixed frames, starting with the `LTD_WORKER_SECRET`
+         * of the environment: the worker is asked for its number of slots and
+         * its compiler version once, then sent the code generation flags of
+         * each compilation and, when it has a free slot, the preprocessed
+         * source, answering with the exit code, the compiler output and the
+         * object file.
+         *
+         * A compilation goes to the worker with the lowest share of busy slots.
+         * When all slots are busy, when a worker refuses because other builds
+         * keep it busy, or when the compilation fails remotely, the caller
+         * compiles locally. A worker that can not be reached or whose compiler
+         * differs from the local one is not used again during the build.
+         *
+         * Objects refer to their split DWARF file and profile data by path,
+         * so such builds are not distributed.
+         */
+        class CompileWorkers
+        {
+        private:
+            struct Worker
+            {
+                string address;
+                int    slots = 0;           // Parallel compilations the worker accepts.
+                int    active = 0;          // Compilations of this build running on it.
+                bool   down = true;
+            };
+
+            string compiler;
+            std::mutex mutex;
+            std::vector<Worker> workers;
+
+        public:
+            CompileWorkers(const string& compiler, const string_list& addresses);
+
+            /**
+             * @brief
+             * Ask every worker for its slots and compiler version.
+             *
+             * @returns The number of usable slots.
+             */
+            int probe();
+
+            /**
+             * @brief
+             * Compile a preprocessed source into `obj` on a worker, appending
+             * the compiler output to the job.
+             *
+             * @returns false if the source has to be compiled locally.
+             */
+            bool compile(const string& flags, const string& preprocessed, const string& obj, Job& job);
+
+        private:
+            int acquire();
+            void release(int index, bool failed);
+        };
+
+        /**
+         * @brief
+         * `ltd worker` processes spawned on Unix sockets for the duration of a
+         * build, a local stand in for a build farm.
+         */
+        class LocalWorkers
+        {
+        private:
+            std::vector<pid_t> pids;
+            string_list addresses;
+
+        public:
+            ~LocalWorkers();
+
+            /**
+             * @brief
+             * Spawn workers with one slot each and wait until they listen.
+             *
+             * @returns err::invalid_operation if a worker did not start.
+             */
+            err start(int count);
+
+            const string_list& get_addresses() const;
+        };
+
+        /**
+         * @brief
+         * Split a comma separated list of worker addresses.
+         */
+        string_list parse_worker_addresses(const string& list);
+
+        /**
+         * @brief
+         * Serve compile requests on an address until the process is killed.
+         *
+         * @details
+         * The worker runs its own compiler, without a shell, in a temporary
+         * directory of its own. Of the flags it is sent, only those that change
+         * the generated code are accepted, a request with any other flag is
+         * refused. A Unix socket is only accessible to the user of the worker,
+         * a TCP worker requires requests to carry its `LTD_WORKER_SECRET`.
+         * Connections beyond a few per slot are closed right away.
+         *
+         * @param slots Maximum number of parallel compilations, further
+         *              requests are refused so the builds compile them locally.
+         * @returns err::invalid_argument if the address can not be listened on,
+         *          a TCP address has no secret or the compiler does not run.
+         */
+        err run_worker(const string& address, const string& compiler, int slots);
+    } // namespace sdk
+} // namespace ltd
+
+#endif // _LTD_INCLUDE_WORKER_HPP_
@@ -9,7 +9,7 @@ echo "\$LTD_HOME is set to '$LTD_HOME'"
 
 echo "Building minimum binary..."
 
-g++ $1 -Ofast -std=c++17 app/ltd.cpp app/sdk.cpp app/compiler.cpp lib/cli.cpp lib/fmt.cpp lib/stddef.cpp -o /tmp/ltd
+g++ $1 -Ofast -std=c++17 -pthread app/ltd.cpp app/sdk.cpp app/compiler.cpp app/jobs.cpp app/jobserver.cpp app/depfile.cpp app/hash.cpp app/cache.cpp app/buildlog.cpp app/config.cpp app/targets.cpp app/profile.cpp app/toolchain.cpp app/trace.cpp app/watch.cpp app/tester.cpp app/bench.cpp app/deploy.cpp app/worker.cpp app/module.cpp app/bmi.cpp lib/cli.cpp lib/fmt.cpp lib/stddef.cpp -o /tmp/ltd
 
 echo "Selecting 'ltd' as active project..."
 /tmp/ltd cd ltd
@@ -45,6 +45,8 @@ namespace ltd
 
             string flag;
             string description;
+            char   short_flag = 0;      // Optional single character alias, i.e. '-j'.
+            int    switch_value = 1;    // Value of an integer param given without value.
 
             param_value value;
 
@@ -56,6 +58,8 @@ namespace ltd
             param_arg(const string& flag, float *value, const string& description);
             param_arg(const string& flag, string *value, const string& description);
             param_arg(const string& flag, string_list *values, const string& description);
+            param_arg(char short_flag, const string& flag, int *value, const string& description);
+            param_arg(const string& flag, int *value, int switch_value, const string& description);
 
             /**
              * @brief
@@ -73,12 +77,30 @@ namespace ltd
              */
             string get_description() const;
 
+            /**
+             * @brief
+             * Get the single character alias of the parameter.
+             * 
+             * @return char The alias or 0 if the parameter has none.
+             */
+            char get_short_flag() const;
+
             bool is_string() const;
             bool is_string_list() const;
             bool is_int() const;
             bool is_float() const;
 
             bool read_flag(const string& argument);
+
+            /**
+             * @brief
+             * Read the value of the parameter given through its single character
+             * alias, i.e. '-j 8' or '-j8'.
+             * 
+             * @param value The string value of the parameter.
+             * @return bool True when the value is accepted.
+             */
+            bool read_value(const string& value);
         };
 
         /**
@@ -179,7 +201,8 @@ namespace ltd
 
         /**
          * @brief
-         * Bind an integer variable to a param in the argument list.
+         * Bind an integer variable to a param in the argument list. A param 
+         * given without value, i.e. '--no-cache', sets the variable to 1.
          * 
          * @param out_val     The variable to receive the param value.
          * @param param       The display name of the parameter.
@@ -187,6 +210,19 @@ namespace ltd
          */
         void bind_param(int& out_val, const string& param, const string& description);
 
+        /**
+         * @brief
+         * Bind an integer variable to a param in the argument list, a param
+         * given without value sets the variable to `switch_value`. I.e. a 
+         * sentinel that tells '--unity' from '--unity=1'.
+         * 
+         * @param out_val      The variable to receive the param value.
+         * @param param        The display name of the parameter.
+         * @param switch_value The value of the param given without value.
+         * @param description  The description text for help.
+         */
+        void bind_param(int& out_val, const string& param, int switch_value, const string& description);
+
         /**
          * @brief
          * Bind a float variable to a param in the argument list.
@@ -197,6 +233,20 @@ namespace ltd
          */
         void bind_param(float& out_val, const string& param, const string& description);
 
+        /**
+         * @brief
+         * Bind an integer variable to a param in the argument list that can
+         * also be given with a single character alias. I.e.:
+         *   --jobs=8, -j 8 or -j8
+         * The param always takes a value, '--jobs' or '-j' alone is an error.
+         * 
+         * @param out_val     The variable to receive the param value.
+         * @param flag        The character representing the param alias.
+         * @param param       The display name of the parameter.
+         * @param description The description text for help.
+         */
+        void bind_param(int& out_val, char flag, const string& param, const string& description);
+
         /**
          * @brief
          * Add command to the argument list.
@@ -217,9 +267,11 @@ namespace ltd
         
         /**
          * @brief
-         * Parse the argc and argv from `main()`.
+         * Parse the argc and argv from `main()`. Arguments that are neither
+         * the command nor an option are left for at().
          * 
-         * @return err The status of the function execution.
+         * @return err invalid_argument or out_of_range when a param value is
+         *         missing or invalid, the other arguments are still parsed.
          */
         err parse();
 
@@ -243,6 +295,20 @@ namespace ltd
          */
         err parse_flag(const string& arg);
 
+        /**
+         * @brief
+         * Parse a parameter given through its single character alias. The value
+         * is either attached to the alias or the next argument.
+         * 
+         * @param arg  The string argument.
+         * @param next The argument following `arg`, consumed when the value is 
+         *             not attached.
+         * @return int The number of arguments consumed, 0 when `arg` is not an
+         *             alias of any parameter, negated when the value is 
+         *             missing or invalid, which is logged as an error.
+         */
+        int parse_short_param(const string& arg, const string& next);
+
         /**
          * @brief
          * Prints all flags, params and commands for the use of printing help or usage.
@@ -1,3 +1,4 @@
+#include <cstdlib>
 #include <stdexcept>
 
 #include "../inc/ltd/cli.hpp"
@@ -54,6 +55,8 @@ namespace ltd
         flag = other.flag;
         value = other.value;
         description = other.description;
+        short_flag = other.short_flag;
+        switch_value = other.switch_value;
     }
 
     cli::param_arg::param_arg(const string& flag, int *value, const string& description)
@@ -84,6 +87,22 @@ namespace ltd
         this->description = description;
     }
 
+    cli::param_arg::param_arg(char short_flag, const string& flag, int *value, const string& description)
+    {
+        this->short_flag = short_flag;
+        this->flag = flag;
+        this->value = value;
+        this->description = description;
+    }
+
+    cli::param_arg::param_arg(const string& flag, int *value, int switch_value, const string& description)
+    {
+        this->flag = flag;
+        this->value = value;
+        this->switch_value = switch_value;
+        this->description = description;
+    }
+
     string cli::param_arg::get_flag() const
     {
         return flag;
@@ -94,41 +113,54 @@ namespace ltd
         return description;
     }
 
+    char cli::param_arg::get_short_flag() const
+    {
+        return short_flag;
+    }
+
     bool cli::param_arg::read_flag(const string& argument)
     {
         auto tokens = split(argument, "=");
 
+        // A bare integer param, i.e. '--no-cache', works as a switch
+        if (tokens.size() == 1 && this->flag == tokens[0] && is_int()) {
+            *std::get<int*>(value) = switch_value;
+            return true;
+        }
+
         if (tokens.size() != 2)
             return false;
 
-        if (this->flag == tokens[0]) {
-            auto param = tokens[1];
-
-            if (is_string()) {
-                string *val = std::get<string*>(value);
-                *val = param;
-            } else if (is_int()) {
-                int *val = std::get<int*>(value);
-                *val = std::stoi(param);
-            } else if (is_float()) {
-                float *val = std::get<float*>(value);
-                *val = std::stof(param);
-            } else if (is_string_list()) {
-                string_list *values = std::get<string_list*>(value);
-                auto arg_params = split(param, ":");
-                
-                for (auto arg_param : arg_params) {
-                    values->push_back(arg_param);
-                }
-            } else
-                return false;
-
-            return true;
-        }
+        if (this->flag == tokens[0])
+            return read_value(tokens[1]);
 
         return false;
     }
 
+    bool cli::param_arg::read_value(const string& param)
+    {
+        if (is_string()) {
+            string *val = std::get<string*>(value);
+            *val = param;
+        } else if (is_int()) {
+            int *val = std::get<int*>(value);
+            *val = std::stoi(param);
+        } else if (is_float()) {
+            float *val = std::get<float*>(value);
+            *val = std::stof(param);
+        } else if (is_string_list()) {
+            string_list *values = std::get<string_list*>(value);
+            auto arg_params = split(param, ":");
+            
+            for (auto arg_param : arg_params) {
+                values->push_back(arg_param);
+            }
+        } else
+            return false;
+
+        return true;
+    }
+
     bool cli::param_arg::is_string() const
     {
         return std::holds_alternative<string*>(value);
@@ -210,11 +242,21 @@ namespace ltd
         params.emplace_back(param, &out_val, description);
     }
 
+    void cli::bind_param(int& out_val, const string& param, int switch_value, const string& description)
+    {
+        params.emplace_back(param, &out_val, switch_value, description);
+    }
+
     void cli::bind_param(float& out_val, const string& param, const string& description)
     {
         params.emplace_back(param, &out_val, description);
     }
 
+    void cli::bind_param(int& out_val, char flag, const string& param, const string& description)
+    {
+        params.emplace_back(flag, param, &out_val, description);
+    }
+
     void cli::add_command(const string& name, int defval, const string& description)
     {
         commands.emplace_back(name, defval, description);
@@ -222,27 +264,40 @@ namespace ltd
 
     err cli::parse()
     {
-        bool first = true;
-        for(const string& arg : args) {
-            if (first) {
-                first = false;
-                if (arg.at(0) != '-') {
+        err result = err::no_error;
+
+        for(std::size_t i = 0; i < args.size(); i++) {
+            const string& arg = args[i];
+
+            if (i == 0) {
+                if (arg.length() > 0 && arg.at(0) != '-') {
                     cmd_value = map_command(arg);
                     continue;
                 }
             }
 
-            if (arg.at(0) == '-' && arg.length() > 1) {
+            if (arg.length() > 1 && arg.at(0) == '-') {
                 if (arg.at(1) == '-' && arg.length() > 2) {
-                    parse_param(arg);
+                    err e = parse_param(arg);
+                    if (e == err::invalid_argument || e == err::out_of_range)
+                        result = e;
                 } else {
-                    parse_flag(arg);
+                    string next = i + 1 < args.size() ? args[i + 1] : "";
+                    int consumed = parse_short_param(arg, next);
+
+                    if (consumed == 0)
+                        parse_flag(arg);
+                    else if (consumed < 0)
+                        result = err::invalid_argument;
+
+                    i += std::abs(consumed) > 0 ? std::abs(consumed) - 1 : 0;
                 }
-            } else
-                return err::invalid_argument;
+            }
+
+            // Positional arguments, i.e. the project of 'ltd cd', are read with at()
         } // for
 
-        return err::no_error;
+        return result;
     }
 
     err cli::parse_param(const string& arg)
@@ -253,16 +308,22 @@ namespace ltd
         auto keyval = arg.substr(2);
         
         for (param_arg &param : params) {
+            // A param with a single character alias always takes a value, i.e. '--jobs' alone
+            if (param.get_short_flag() != 0 && keyval == param.get_flag()) {
+                error("Missing value for --%s", param.get_flag());
+                return err::invalid_argument;
+            }
+
             try {
                 if (param.read_flag(keyval) == true)
                     return err::no_error;
             } catch (std::invalid_argument const& ex)
             {
-                // TODO:: log error
+                error("Invalid value for --%s: %s", param.get_flag(), arg);
                 return err::invalid_argument;
             } catch (std::out_of_range const& ex)
             {
-                // TODO:: log error
+                error("Value out of range for --%s: %s", param.get_flag(), arg);
                 return err::out_of_range;
             }
         }
@@ -293,6 +354,44 @@ namespace ltd
         return err::no_error;
     }
 
+    int cli::parse_short_param(const string& arg, const string& next)
+    {
+        if (arg.at(0) != '-' || arg.size() <= 1)
+            return 0;
+
+        for (param_arg &param : params) {
+            if (param.get_short_flag() == 0 || param.get_short_flag() != arg.at(1))
+                continue;
+
+            bool attached = arg.size() > 2;
+
+            // An option is never the value, i.e. '-j -v'
+            if (!attached && (next.length() == 0 || next.at(0) == '-')) {
+                error("Missing value for -%c", param.get_short_flag());
+                return -1;
+            }
+
+            string value = attached ? arg.substr(2) : next;
+            int consumed = attached ? 1 : 2;
+
+            try {
+                param.read_value(value);
+            } catch (std::invalid_argument const& ex)
+            {
+                error("Invalid value for -%c: %s", param.get_short_flag(), value);
+                return -consumed;
+            } catch (std::out_of_range const& ex)
+            {
+                error("Value out of range for -%c: %s", param.get_short_flag(), value);
+                return -consumed;
+            }
+
+            return consumed;
+        }
+
+        return 0;
+    }
+
     int cli::map_command(const string& name) const
     {
         for (const command& cmd : commands) {
@@ -325,7 +424,10 @@ namespace ltd
         fmt::println("");
 
         for (auto param : params) {
-            fmt::println("  --%-12s %s", param.get_flag(), param.get_description());
+            if (param.get_short_flag() != 0)
+                fmt::println("  -%c, --%-8s %s", param.get_short_flag(), param.get_flag(), param.get_description());
+            else
+                fmt::println("  --%-12s %s", param.get_flag(), param.get_description());
         }
     }
 
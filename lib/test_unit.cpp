@@ -25,7 +25,7 @@ namespace ltd
         int all       = 0;
         int help      = 0;
         int test_id   = -1;
-        int test_count= -1;
+        int test_count= 0;
 
         cli flags(argc, argv);
 
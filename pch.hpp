@@ -0,0 +1,17 @@
+/**
+ * @brief
+ * Prefix header of ltd itself. It is precompiled by `ltd build` and included
+ * into every source ahead of its own includes, so the heavy standard headers
+ * are only parsed once per build mode.
+ */
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "inc/ltd/cli.hpp"
+#include "inc/ltd/fmt.hpp"
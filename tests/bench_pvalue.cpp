@@ -0,0 +1,54 @@
+#include "../inc/ltd/test_unit.hpp"
+#include "../inc/ltd/stddef.hpp"
+
+#include <vector>
+
+#include "../app/bench.hpp"
+
+using namespace ltd;
+
+namespace
+{
+    // Ten timings from `first` on, one apart
+    std::vector<double> timings(double first)
+    {
+        std::vector<double> values;
+        for (int i = 0; i < 10; i++)
+            values.push_back(first + i);
+
+        return values;
+    }
+}
+
+auto main(int argc, char** argv) -> int
+{
+    test_unit tu;
+
+    tu.test([&tu](){
+        tu.expect(sdk::slowdown_p_value(timings(100), timings(200)) < 0.001, true);
+        tu.expect(sdk::slowdown_p_value(timings(100), timings(50)) > 0.999, true);
+    });
+
+    tu.test([&tu](){
+        // Equal timings are all ties, a slight shift is still noticed
+        tu.expect(sdk::slowdown_p_value(timings(100), timings(100)) > 0.5, true);
+        tu.expect(sdk::slowdown_p_value(timings(100), timings(103)) < 0.05, true);
+    });
+
+    tu.test([&tu](){
+        // A single outlier does not make a regression
+        std::vector<double> samples = timings(100);
+        samples.back() = 1000;
+
+        tu.expect(sdk::slowdown_p_value(timings(100), samples) > 0.05, true);
+    });
+
+    tu.test([&tu](){
+        tu.expect(sdk::slowdown_p_value({}, timings(100)), 1.0);
+        tu.expect(sdk::slowdown_p_value(timings(100), {}), 1.0);
+    });
+
+    tu.run(argc, argv);
+
+    return 0;
+}
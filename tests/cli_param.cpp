@@ -0,0 +1,154 @@
+#include "../inc/ltd/test_unit.hpp"
+#include "../inc/ltd/cli.hpp"
+
+using namespace ltd;
+
+auto main(int argc, char** argv) -> int
+{
+    test_unit tu;
+
+    tu.test([&tu](){
+        char* argv[] = { (char*)"ltd", (char*)"build", (char*)"--jobs=8" };
+        int jobs = 0;
+
+        cli args(3, argv);
+        args.bind_param(jobs, 'j', "jobs", "Number of jobs");
+        args.parse();
+
+        tu.expect(jobs, 8);
+    });
+
+    tu.test([&tu](){
+        char* argv[] = { (char*)"ltd", (char*)"build", (char*)"-j", (char*)"8", (char*)"-v" };
+        int jobs = 0;
+        int verbosity = 0;
+
+        cli args(5, argv);
+        args.bind_flag(verbosity, 'v', "Verbosity");
+        args.bind_param(jobs, 'j', "jobs", "Number of jobs");
+        args.parse();
+
+        tu.expect(jobs, 8);
+        tu.expect(verbosity, 1);
+    });
+
+    tu.test([&tu](){
+        char* argv[] = { (char*)"ltd", (char*)"build", (char*)"-j12", (char*)"-vv" };
+        int jobs = 0;
+        int verbosity = 0;
+
+        cli args(4, argv);
+        args.bind_flag(verbosity, 'v', "Verbosity");
+        args.bind_param(jobs, 'j', "jobs", "Number of jobs");
+        args.parse();
+
+        tu.expect(jobs, 12);
+        tu.expect(verbosity, 2);
+    });
+
+    tu.test([&tu](){
+        char* argv[] = { (char*)"ltd", (char*)"build", (char*)"-v" };
+        int jobs = 4;
+
+        cli args(3, argv);
+        args.bind_param(jobs, 'j', "jobs", "Number of jobs");
+        args.parse();
+
+        tu.expect(jobs, 4);
+    });
+
+    tu.test([&tu](){
+        char* argv[] = { (char*)"ltd", (char*)"build", (char*)"-j", (char*)"-v" };
+        int jobs = 4;
+        int verbosity = 0;
+
+        cli args(4, argv);
+        args.bind_flag(verbosity, 'v', "Verbosity");
+        args.bind_param(jobs, 'j', "jobs", "Number of jobs");
+        err e = args.parse();
+
+        tu.expect((int)e, (int)err::invalid_argument);
+        tu.expect(jobs, 4);
+        tu.expect(verbosity, 1);
+    });
+
+    tu.test([&tu](){
+        char* argv[] = { (char*)"ltd", (char*)"build", (char*)"-j", (char*)"x", (char*)"-v" };
+        int jobs = 4;
+        int verbosity = 0;
+
+        cli args(5, argv);
+        args.bind_flag(verbosity, 'v', "Verbosity");
+        args.bind_param(jobs, 'j', "jobs", "Number of jobs");
+        err e = args.parse();
+
+        tu.expect((int)e, (int)err::invalid_argument);
+        tu.expect(jobs, 4);
+        tu.expect(verbosity, 1);
+    });
+
+    tu.test([&tu](){
+        char* argv[] = { (char*)"ltd", (char*)"build", (char*)"--jobs", (char*)"-v" };
+        int jobs = 4;
+        int verbosity = 0;
+
+        cli args(4, argv);
+        args.bind_flag(verbosity, 'v', "Verbosity");
+        args.bind_param(jobs, 'j', "jobs", "Number of jobs");
+        err e = args.parse();
+
+        tu.expect((int)e, (int)err::invalid_argument);
+        tu.expect(jobs, 4);
+        tu.expect(verbosity, 1);
+    });
+
+    tu.test([&tu](){
+        char* argv[] = { (char*)"ltd", (char*)"cd", (char*)"ltd", (char*)"-v" };
+        int verbosity = 0;
+
+        cli args(4, argv);
+        args.bind_flag(verbosity, 'v', "Verbosity");
+        err e = args.parse();
+
+        tu.expect((int)e, (int)err::no_error);
+        tu.expect(verbosity, 1);
+        tu.expect(std::get<0>(args.at(1)), string("ltd"));
+    });
+
+    tu.test([&tu](){
+        char* argv[] = { (char*)"ltd", (char*)"build", (char*)"--no-cache" };
+        int no_cache = 0;
+
+        cli args(3, argv);
+        args.bind_param(no_cache, "no-cache", "Disable cache");
+        args.parse();
+
+        tu.expect(no_cache, 1);
+    });
+
+    tu.test([&tu](){
+        char* argv[] = { (char*)"ltd", (char*)"build", (char*)"--unity" };
+        int unity = 0;
+
+        cli args(3, argv);
+        args.bind_param(unity, "unity", -1, "Unity batch size");
+        args.parse();
+
+        tu.expect(unity, -1);
+    });
+
+    tu.test([&tu](){
+        char* argv[] = { (char*)"ltd", (char*)"build", (char*)"--unity=1" };
+        int unity = 0;
+
+        cli args(3, argv);
+        args.bind_param(unity, "unity", -1, "Unity batch size");
+        args.parse();
+
+        tu.expect(unity, 1);
+    });
+
+    tu.run(argc, argv);
+
+    return 0;
+}
@@ -0,0 +1,53 @@
+#include "../inc/ltd/test_unit.hpp"
+#include "../inc/ltd/stddef.hpp"
+
+#include "../app/depfile.hpp"
+
+using namespace ltd;
+
+namespace
+{
+    string parse(const string& content)
+    {
+        string_list deps;
+        sdk::parse_depfile_content(content.data(), content.data() + content.size(), deps);
+
+        string result;
+        for (const auto& dep : deps)
+            result += (result.length() > 0 ? "|" : "") + dep;
+
+        return result;
+    }
+}
+
+auto main(int argc, char** argv) -> int
+{
+    test_unit tu;
+
+    tu.test([&tu](){
+        string deps = parse("main.o: main.cpp inc/my\\ header.hpp \\\n /usr/include/stdio.h\n");
+
+        tu.expect(deps, string("main.cpp|inc/my header.hpp|/usr/include/stdio.h"));
+    });
+
+    tu.test([&tu](){
+        // Make escapes '$' as '$$', Windows editors leave CRLF continuations
+        string deps = parse("a.o: price$$.h \\\r\n b.h\r\n");
+
+        tu.expect(deps, string("price$.h|b.h"));
+    });
+
+    tu.test([&tu](){
+        // Written by g++ -fmodules-ts for a source importing the module 'foo'
+        string deps = parse("main.o gcm.cache/main.gcm: main.cpp foo.hpp\n"
+                            "main.o: foo.c++m\n"
+                            "foo.c++m: gcm.cache/foo.gcm\n"
+                            ".PHONY: foo.c++m\n");
+
+        tu.expect(deps, string("main.cpp|foo.hpp"));
+    });
+
+    tu.run(argc, argv);
+
+    return 0;
+}
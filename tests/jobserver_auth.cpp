@@ -0,0 +1,99 @@
+#include "../inc/ltd/test_unit.hpp"
+#include "../inc/ltd/stddef.hpp"
+#include "../inc/ltd/fmt.hpp"
+
+#include <cstdlib>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../app/jobserver.hpp"
+
+using namespace ltd;
+
+namespace
+{
+    /**
+     * @brief
+     * Attach to a make jobserver pipe holding `tokens` tokens.
+     *
+     * @returns The number of tokens taken from it, -1 if it was not attached.
+     */
+    int take_tokens(const string& options, int tokens)
+    {
+        int fds[2];
+        if (pipe(fds) != 0)
+            return -1;
+
+        for (int i = 0; i < tokens; i++) {
+            if (write(fds[1], "+", 1) != 1)
+                return -1;
+        }
+
+        int taken = -1;
+        {
+            sdk::JobServer server;
+            string makeflags = fmt::sprintf(options.c_str(), fds[0], fds[1]);
+
+            if (server.attach(makeflags) == err::no_error) {
+                char token;
+                for (taken = 0; server.try_acquire(token); taken++);
+            }
+        }
+
+        close(fds[0]);
+        close(fds[1]);
+
+        return taken;
+    }
+}
+
+auto main(int argc, char** argv) -> int
+{
+    test_unit tu;
+
+    tu.test([&tu](){
+        tu.expect(take_tokens("-j4 --jobserver-auth=%d,%d", 3), 3);
+    });
+
+    tu.test([&tu](){
+        // Make before 4.2 wrote --jobserver-fds, the last option wins
+        tu.expect(take_tokens("--jobserver-fds=998,999 -j --jobserver-auth=%d,%d", 2), 2);
+        tu.expect(take_tokens("--jobserver-auth=998,999 --jobserver-fds=%d,%d", 2), 2);
+    });
+
+    tu.test([&tu](){
+        sdk::JobServer server;
+
+        tu.expect((int)server.attach("-k -j4"), (int)err::not_found);
+        tu.expect((int)server.attach("--jobserver-auth=998,999"), (int)err::invalid_state);
+    });
+
+    tu.test([&tu](){
+        char temp_dir[] = "/tmp/ltd-jobserver-XXXXXX";
+        if (mkdtemp(temp_dir) == nullptr)
+            return;
+
+        string fifo = string(temp_dir) + "/fifo";
+        mkfifo(fifo.c_str(), 0600);
+
+        {
+            sdk::JobServer server;
+            tu.expect((int)server.attach("-j8 --jobserver-auth=fifo:" + fifo), (int)err::no_error);
+
+            // Nothing was written to the fifo yet
+            char token;
+            tu.expect(server.try_acquire(token), false);
+
+            server.release('+');
+            tu.expect(server.try_acquire(token), true);
+            tu.expect(string(1, token), string("+"));
+        }
+
+        unlink(fifo.c_str());
+        rmdir(temp_dir);
+    });
+
+    tu.run(argc, argv);
+
+    return 0;
+}
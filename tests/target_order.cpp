@@ -0,0 +1,111 @@
+#include "../inc/ltd/test_unit.hpp"
+#include "../inc/ltd/stddef.hpp"
+
+#include <cstdlib>
+#include <filesystem>
+
+#include "../app/config.hpp"
+#include "../app/targets.hpp"
+
+using namespace ltd;
+
+namespace
+{
+    /**
+     * @brief
+     * Load the targets of a project with the libraries base, net and ui, the
+     * applications client and tool, and tests.
+     */
+    err load_graph(const sdk::ProjectConfig& config, sdk::TargetGraph& graph)
+    {
+        char temp_dir[] = "/tmp/ltd-targets-XXXXXX";
+        if (mkdtemp(temp_dir) == nullptr)
+            return err::invalid_operation;
+
+        string project_path = temp_dir;
+        for (auto dir : { "libs/base", "libs/net", "libs/ui", "apps/client", "apps/tool", "tests" })
+            std::filesystem::create_directories(project_path + "/" + dir);
+
+        err e = graph.load("project", project_path, config);
+
+        std::filesystem::remove_all(project_path);
+
+        return e;
+    }
+
+    string link_order(const sdk::TargetGraph& graph, const string& name)
+    {
+        string order;
+        for (const auto& target : graph.get_targets()) {
+            if (target.name != name)
+                continue;
+
+            for (const auto& lib : graph.link_order(target))
+                order += (order.length() > 0 ? ":" : "") + lib;
+        }
+
+        return order;
+    }
+}
+
+auto main(int argc, char** argv) -> int
+{
+    test_unit tu;
+
+    tu.test([&tu](){
+        sdk::ProjectConfig config;
+        config.set("net.deps", "base");
+        config.set("ui.deps", "base");
+        config.set("client.deps", "ui:net");
+        config.set("tool.deps", "base");
+
+        sdk::TargetGraph graph;
+        tu.expect((int)load_graph(config, graph), (int)err::no_error);
+
+        string order;
+        for (const auto& target : graph.get_targets())
+            order += (order.length() > 0 ? ":" : "") + target.name;
+
+        tu.expect(order, string("base:net:ui:client:tool:tests"));
+    });
+
+    tu.test([&tu](){
+        sdk::ProjectConfig config;
+        config.set("net.deps", "base");
+        config.set("ui.deps", "base");
+        config.set("client.deps", "ui:net");
+        config.set("tool.deps", "base");
+
+        sdk::TargetGraph graph;
+        load_graph(config, graph);
+
+        // Every library comes before the libraries it depends on
+        tu.expect(link_order(graph, "client"), string("net:ui:base"));
+        tu.expect(link_order(graph, "tool"), string("base"));
+        tu.expect(link_order(graph, "tests"), string("ui:net:base"));
+        tu.expect(link_order(graph, "ui"), string("base"));
+        tu.expect(link_order(graph, "base"), string(""));
+    });
+
+    tu.test([&tu](){
+        sdk::ProjectConfig config;
+        config.set("base.deps", "ui");
+        config.set("ui.deps", "net");
+        config.set("net.deps", "base");
+
+        sdk::TargetGraph graph;
+        tu.expect((int)load_graph(config, graph), (int)err::invalid_state);
+    });
+
+    tu.test([&tu](){
+        sdk::ProjectConfig config;
+        config.set("tool.deps", "base:sql");
+
+        sdk::TargetGraph graph;
+        tu.expect((int)load_graph(config, graph), (int)err::not_found);
+    });
+
+    tu.run(argc, argv);
+
+    return 0;
+}
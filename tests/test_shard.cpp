@@ -0,0 +1,52 @@
+#include "../inc/ltd/test_unit.hpp"
+#include "../inc/ltd/stddef.hpp"
+
+#include "../app/tester.hpp"
+
+using namespace ltd;
+
+auto main(int argc, char** argv) -> int
+{
+    test_unit tu;
+
+    tu.test([&tu](){
+        sdk::TestOptions options;
+        err e = sdk::parse_shard("2/4", options);
+
+        tu.expect((int)e, (int)err::no_error);
+        tu.expect(options.shard_index, 1);
+        tu.expect(options.shard_count, 4);
+    });
+
+    tu.test([&tu](){
+        sdk::TestOptions options;
+        err e = sdk::parse_shard("1/1", options);
+
+        tu.expect((int)e, (int)err::no_error);
+        tu.expect(options.shard_index, 0);
+        tu.expect(options.shard_count, 1);
+    });
+
+    tu.test([&tu](){
+        // The shard counts from 1 and can not be past the count
+        for (auto shard : { "0/4", "5/4", "1/0", "-1/4" }) {
+            sdk::TestOptions options;
+
+            tu.expect((int)sdk::parse_shard(shard, options), (int)err::invalid_argument);
+            tu.expect(options.shard_index, 0);
+            tu.expect(options.shard_count, 1);
+        }
+    });
+
+    tu.test([&tu](){
+        for (auto shard : { "2", "a/4", "2/", "" }) {
+            sdk::TestOptions options;
+
+            tu.expect((int)sdk::parse_shard(shard, options), (int)err::invalid_argument);
+        }
+    });
+
+    tu.run(argc, argv);
+
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include "../inc/ltd/test_unit.hpp"
+#include "../inc/ltd/stddef.hpp"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "../app/jobs.hpp"
+#include "../app/trace.hpp"
+
+using namespace ltd;
+
+namespace
+{
+    // Written by clang 15 with -ftime-trace for main.o, shortened
+    const char* CLANG_TIME_TRACE =
+        "{\"traceEvents\":["
+        "{\"pid\":4242,\"tid\":4242,\"ph\":\"X\",\"ts\":1520,\"dur\":8200,\"name\":\"Source\",\"args\":{\"detail\":\"/usr/include/c++/12/iostream\"}},"
+        "{\"pid\":4242,\"tid\":4242,\"ph\":\"X\",\"ts\":12000,\"dur\":3000,\"name\":\"InstantiateFunction\",\"args\":{\"detail\":\"std::vector<int>::push_back\"}},"
+        "{\"pid\":4242,\"tid\":4242,\"ph\":\"X\",\"ts\":0,\"dur\":20000,\"name\":\"ExecuteCompiler\"},"
+        "{\"pid\":4242,\"tid\":4243,\"ph\":\"X\",\"ts\":0,\"dur\":20000,\"name\":\"Total ExecuteCompiler\",\"args\":{\"count\":1,\"avg ms\":20}},"
+        "{\"cat\":\"\",\"pid\":4242,\"tid\":0,\"ts\":0,\"ph\":\"M\",\"name\":\"process_name\",\"args\":{\"name\":\"clang-15\"}}"
+        "],\"beginningOfTime\":1697040000000000}\n";
+
+    /**
+     * @brief
+     * Trace a compile job of 25 ms on worker 2 whose object has the clang
+     * time trace next to it.
+     *
+     * @returns The lines of the trace written.
+     */
+    string_list merge_trace()
+    {
+        char temp_dir[] = "/tmp/ltd-trace-XXXXXX";
+        if (mkdtemp(temp_dir) == nullptr)
+            return {};
+
+        string dir = temp_dir;
+        std::ofstream(dir + "/main.json") << CLANG_TIME_TRACE;
+
+        sdk::BuildTrace trace(dir + "/trace.json");
+
+        sdk::Job job;
+        job.name       = "main.cpp";
+        job.category   = "compile";
+        job.target     = dir + "/main.o";
+        job.slot       = 2;
+        job.start_time = sdk::steady_micros();
+        job.end_time   = job.start_time + 25000;
+
+        trace.add_jobs({ job });
+        trace.save();
+
+        std::ifstream in(dir + "/trace.json");
+        std::stringstream content;
+        content << in.rdbuf();
+
+        std::filesystem::remove_all(dir);
+
+        return split(content.str(), "\n");
+    }
+
+    string find_event(const string_list& lines, const string& name)
+    {
+        for (const auto& line : lines) {
+            if (line.find("\"name\":\"" + name + "\"") != string::npos)
+                return line;
+        }
+
+        return "";
+    }
+
+    long read_number(const string& event, const string& field)
+    {
+        size_t index = event.find("\"" + field + "\":");
+        return index != string::npos ? std::atol(event.c_str() + index + field.length() + 3) : -1;
+    }
+}
+
+auto main(int argc, char** argv) -> int
+{
+    test_unit tu;
+
+    tu.test([&tu](){
+        string_list lines = merge_trace();
+
+        string compile = find_event(lines, "main.cpp");
+        string compiler = find_event(lines, "ExecuteCompiler");
+        string source = find_event(lines, "Source");
+
+        // The clang events end with the job, on its lane
+        tu.expect((int)(read_number(compiler, "ts") - read_number(compile, "ts")), 5000);
+        tu.expect((int)(read_number(source, "ts") - read_number(compile, "ts")), 6520);
+        tu.expect((int)read_number(compiler, "pid"), 1);
+        tu.expect((int)read_number(compiler, "tid"), 2);
+        tu.expect((int)read_number(find_event(lines, "Total ExecuteCompiler"), "tid"), 2);
+    });
+
+    tu.test([&tu](){
+        string_list lines = merge_trace();
+
+        int events = 0;
+        for (const auto& line : lines) {
+            if (line.compare(0, 1, "{") == 0 && line.find("\"ph\":") != string::npos)
+                events++;
+        }
+
+        // The job, its worker lane name and the four clang events, without the clang process name
+        tu.expect(events, 6);
+        tu.expect(find_event(lines, "process_name"), "");
+        tu.expect(find_event(lines, "thread_name").find("worker 2") != string::npos, true);
+    });
+
+    tu.run(argc, argv);
+
+    return 0;
+}